@@ -0,0 +1,68 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/aruco.hpp>
+
+#include "cameraSettings.hpp"
+#include "ledGridDecoder.hpp"
+#include "multiDictDetector.hpp"
+#include "stripePool.hpp"
+
+#define DELTA 12
+
+extern cv::Ptr<cv::aruco::DetectorParameters> ARUCO_PARAMS;
+
+extern const std::map<std::string, int> supportedArucoTypes;
+
+/**
+ * @brief A single marker found on a frame, kept around after drawing so that other consumers
+ *        (latency harness, recorders, ...) can use it
+ */
+struct MarkerDetection {
+    int id;
+    std::vector<cv::Point2f> corners;
+    cv::Vec3d rvec;
+    cv::Vec3d tvec;
+    std::string dictName;  // only filled in when detecting with several dictionaries
+    bool reused = false;   // carried over from a previous frame (MotionGate), not detected on this one
+};
+
+/**
+ * @brief Everything the frame loop needs to process a frame that may be changed while running
+ */
+struct DetectionConfig {
+    std::string dictName;
+    cv::Ptr<cv::aruco::Dictionary> dict;
+    cv::Ptr<MultiDictDetector> multiDict;  // when set, used instead of dict
+    cv::Ptr<LedGridDecoder> ledDecoder;    // when set, used instead of the marker detectors (same dictionaries)
+    char targetClr = 'w';
+    int delta = DELTA;
+    cv::Size kernelSize = cv::Size(10, 10);
+    cv::Ptr<cv::aruco::DetectorParameters> params;
+    cv::Ptr<StripePool> stripePool;  // when set, processFrame() runs over stripes on these threads
+};
+
+void maskFrame(const cv::Mat &inFrame, cv::Mat &outFrame, char targetClr, int delta = DELTA);
+void processFrame(const cv::Mat &inFrame, cv::Mat &outFrame, char targetClr, cv::Size kSize = cv::Size(10, 10),
+                  int delta = DELTA);
+void processFrameStriped(const cv::Mat &inFrame, cv::Mat &outFrame, char targetClr, StripePool &pool,
+                         cv::Size kSize = cv::Size(10, 10), int delta = DELTA, int stripeCount = 0);
+void processLedFrame(const cv::Mat &inFrame, cv::Mat &outFrame, char targetClr, int delta = DELTA);
+void drawMarkers(CameraSettings cs, cv::Mat &original, const std::vector<MarkerDetection> &detections, float mLen);
+void detectMarkers(CameraSettings cs, cv::Mat &original, cv::Mat &masked, cv::Ptr<cv::aruco::Dictionary> dict,
+                   float mLen, std::vector<MarkerDetection> &detections,
+                   cv::Ptr<cv::aruco::DetectorParameters> params = ARUCO_PARAMS);
+void detectMarkers(CameraSettings cs, cv::Mat &original, cv::Mat &masked, const MultiDictDetector &detector,
+                   float mLen, std::vector<MarkerDetection> &detections,
+                   cv::Ptr<cv::aruco::DetectorParameters> params = ARUCO_PARAMS);
+void detectMarkers(CameraSettings cs, cv::Mat &original, cv::Mat &masked, const LedGridDecoder &decoder,
+                   float mLen, std::vector<MarkerDetection> &detections);
+
+void makeDetectionConfig(const std::string &dict, const std::string &dictList, bool ledGrid, char targetClr,
+                         DetectionConfig &config);
+void detectFrame(CameraSettings cs, const DetectionConfig &config, cv::Mat &frame, cv::Mat &masked, float mLen,
+                 std::vector<MarkerDetection> &detections);
@@ -1,15 +1,23 @@
+#pragma once
+
 #include <map>
 #include <string>
 
 #include <opencv2/aruco.hpp>
 
-class ArucoSettings {
-   private:
-    bool OK = true;
+#include "arucoPipeline.hpp"
+
+// written by the parameter tuner (--tune), loaded at startup when present
+#define ARUCO_PROFILE_PATH "../resources/aruco_profile.yml"
 
+class ArucoSettings {
    public:
+    bool OK = true;
     float squareSize;
 
+    int delta = DELTA;                       // color mask threshold (maskFrame())
+    cv::Size kernelSize = cv::Size(10, 10);  // dilate/erode kernel (processFrame())
+
     cv::Ptr<cv::aruco::Dictionary> arucoDict;
     cv::Ptr<cv::aruco::DetectorParameters> arucoParams;
 
@@ -30,4 +38,8 @@ class ArucoSettings {
     };
 
     ArucoSettings();
-};
\ No newline at end of file
+    ArucoSettings(std::string filepath);
+
+    bool save(std::string filepath) const;
+    void apply(DetectionConfig &config) const;
+};
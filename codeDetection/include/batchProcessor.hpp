@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "arucoPipeline.hpp"
+#include "arucoSettings.hpp"
+
+/**
+ * @brief Offline processing of recordings (.carec) and image directories
+ */
+struct BatchSettings {
+    std::vector<std::string> inputs;
+    std::string outputPath;  // detection records, same format as the live --detections log
+    int threads = 0;         // 0 = one per core
+    std::string dict = "4_50";
+    std::string dictList;
+    bool ledGrid = false;
+    char targetClr = 'w';
+    float markerLength = 0;       // meters, 0 = use the one stored in each recording
+    std::string calibrationPath;  // for image directories and recordings saved without calibration
+    const ArucoSettings *profile = nullptr;  // tuned detector profile, defaults when not set
+};
+
+bool runBatch(const BatchSettings &bs);
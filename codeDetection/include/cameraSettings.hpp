@@ -1,3 +1,5 @@
+#pragma once
+
 #include <opencv2/core.hpp>
 #include <opencv2/aruco.hpp>
 
@@ -11,6 +13,7 @@ class CameraSettings {
     cv::Mat distortionCoeffs;
 
     CameraSettings(string filepath);
+    CameraSettings(cv::Mat camMatrix, cv::Mat distCoeffs);
     bool runCalibrationAndSave(const cv::Size chessboardSize, const float calibrationSquareSize);
 
    private:
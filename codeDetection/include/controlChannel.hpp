@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <opencv2/aruco.hpp>
+
+#include "arucoPipeline.hpp"
+#include "ledGridDecoder.hpp"
+#include "multiDictDetector.hpp"
+
+/**
+ * @brief Line based command interface that runs beside the frame loop (stdin and, optionally, a unix socket).
+ *        Commands are validated on the reader threads and the resulting config is only picked up by the frame loop
+ *        through poll(), so typing never stalls capture.
+ *
+ *        commands: dict <type> | dicts <type,type,...> | decoder <aruco/led> | color <r/g/b/w> | delta <0-255> |
+ *                  param <name> <value> | show | help | quit
+ */
+class ControlChannel {
+   public:
+    bool OK = true;
+
+    ControlChannel(const DetectionConfig &initial, std::string socketPath = "");
+    ~ControlChannel();
+
+    bool poll(DetectionConfig &config);
+    bool quitRequested() const;
+
+   private:
+    std::string socketPath;
+    int listenFd = -1;
+
+    std::thread stdinThread;
+    std::thread socketThread;
+    std::atomic<bool> running = true;
+    std::atomic<bool> quit = false;
+
+    std::mutex configMutex;
+    DetectionConfig latest;  // newest accepted config, what the next command builds on
+    std::atomic<bool> pending = false;
+
+    void stdinLoop();
+    void socketLoop();
+    bool execute(const std::string &line, std::string &reply);
+};
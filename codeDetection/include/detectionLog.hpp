@@ -0,0 +1,30 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "arucoPipeline.hpp"
+
+/**
+ * @brief Detection records written by the live loop (--detections) and by the batch mode: one csv line per marker,
+ *        fixed precision, so the output of two runs or two builds can be diffed directly. Records are buffered and
+ *        flushed at most every DETECTION_LOG_FLUSH_MS and on close.
+ */
+class DetectionLog {
+   public:
+    bool OK = false;
+
+    DetectionLog(const std::string &filepath);
+
+    void write(const std::string &records);
+    void close();
+    static std::string format(const std::string &source, long frameIndex, int64_t timestampNs,
+                              const std::string &dictName, const std::vector<MarkerDetection> &detections);
+
+   private:
+    std::ofstream file;
+    std::chrono::steady_clock::time_point lastFlush;
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// same layout as the arduino firmware (arduinoSrc/src/main.cpp)
+#define LED_COUNT 100
+#define LINE_LED_COUNT 10
+#define CODE_SIZE 7
+
+/**
+ * @brief Snapshot of what the led strip is showing - pixels are indexed in strip order (serpentine), exactly as
+ *        the firmware calls leds.setPixelColor()
+ */
+struct LedStripState {
+    std::array<uint32_t, LED_COUNT> pixels{};
+    uint8_t brightness = 0;
+    uint64_t revision = 0;  // incremented every time the strip is redrawn
+};
+
+/**
+ * @brief Emulates the colAruco arduino firmware behind a pseudo terminal. The slave side (portName()) accepts the
+ *        same serial protocol as the real board, so colAruco.py or a test can drive it like /dev/ttyACM0.
+ */
+class FirmwareEmulator {
+   public:
+    bool OK = false;
+
+    FirmwareEmulator();
+    ~FirmwareEmulator();
+
+    std::string portName() const;
+    LedStripState snapshot();
+
+   private:
+    int masterFd = -1;
+    int slaveFd = -1;
+    std::string slaveName;
+
+    std::thread serialThread;
+    std::atomic<bool> running = false;
+
+    std::mutex stripMutex;
+    LedStripState strip;
+
+    // firmware variables (loop() statics)
+    uint32_t colorOnDisplay = 0;
+    uint8_t brightnessOnDisplay = 0;
+    uint8_t arucoOnDisplay[LINE_LED_COUNT] = {0};
+    uint8_t arucoCodeSize = 0;
+
+    // single EEPROM preset
+    uint32_t savedColor = 0;
+    uint8_t savedBrightness = 0;
+    uint8_t savedAruco[LINE_LED_COUNT] = {0};
+    uint8_t savedSize = 0;
+
+    std::deque<std::string> tokens;
+
+    void serialLoop();
+    int inputParser();
+    void reportState();
+    void serialPrint(const std::string &text);
+
+    void applyAruco();
+    void testLedStrip();
+};
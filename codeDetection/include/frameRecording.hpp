@@ -0,0 +1,142 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+/*
+ * Recording container (.carec), native byte order:
+ *
+ *   FileHeader | metadata (FileStorage yaml, padded to RECORDING_ALIGNMENT) | chunk | chunk | ...
+ *   chunk = ChunkHeader | FrameEntry[frameCount] | frame payloads, padded to RECORDING_ALIGNMENT
+ *
+ * Chunks start on page boundaries and raw payloads are aligned, so a mapped recording is read in place. There is no
+ * trailing index: chunks are found by hopping over chunkBytes, which also keeps everything up to the last complete
+ * chunk readable when a recording is cut short.
+ */
+#define RECORDING_MAGIC "COLAREC1"
+#define RECORDING_CHUNK_MAGIC "CHNK"
+#define RECORDING_VERSION 1
+#define RECORDING_ALIGNMENT 4096
+#define RECORDING_PAYLOAD_ALIGNMENT 64
+
+enum FrameEncoding : int32_t { FRAME_RAW = 0, FRAME_PNG = 1 };
+
+struct RecordingFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t metadataBytes;
+};
+
+struct RecordingChunkHeader {
+    char magic[4];
+    uint32_t frameCount;
+    uint64_t chunkBytes;  // whole chunk, header and padding included
+};
+
+struct RecordingFrameEntry {
+    int64_t timestampNs;  // capture time (system clock), -1 when unknown
+    uint64_t offset;      // from the start of the chunk
+    uint64_t bytes;
+    int32_t rows;
+    int32_t cols;
+    int32_t type;
+    int32_t encoding;
+};
+
+/**
+ * @brief What is known about the source of a recording, kept in its header
+ */
+struct RecordingMetadata {
+    cv::Mat cameraMatrix;
+    cv::Mat distortionCoeffs;
+    double markerLength = 0;  // meters, 0 when unknown
+    std::string source;
+};
+
+struct RecordingSettings {
+    int framesPerChunk = 32;
+    bool compress = true;  // lossless png, otherwise raw pixels
+    int pngLevel = 1;      // speed over size, so the writer thread keeps up with capture
+    int queueFrames = 64;  // frames waiting for the writer thread, further frames are dropped instead of waited for
+};
+
+/**
+ * @brief Appends frames to a recording, one chunk at a time. write() only copies the frame into a bounded queue,
+ *        encoding and disk writes happen on a writer thread so they never hold up the capture loop.
+ */
+class RecordingWriter {
+   public:
+    bool OK = false;
+    RecordingSettings settings;
+
+    RecordingWriter(const std::string &filepath, const RecordingMetadata &metadata,
+                    RecordingSettings settings = RecordingSettings());
+    ~RecordingWriter();
+
+    bool write(const cv::Mat &frame, int64_t timestampNs);
+    void close();
+    long frameCount() const;
+    long droppedFrames() const;
+
+   private:
+    struct QueuedFrame {
+        cv::Mat frame;
+        int64_t timestampNs;
+    };
+
+    std::ofstream file;
+    std::vector<RecordingFrameEntry> entries;
+    std::vector<std::vector<uchar> > payloads;
+    std::atomic<long> writtenFrames = 0;
+    std::atomic<long> dropped = 0;
+    std::atomic<bool> failed = false;
+
+    std::mutex queueMutex;
+    std::condition_variable queueReady;
+    std::deque<QueuedFrame> queue;
+    bool closing = false;
+    std::thread writerThread;
+
+    void writerLoop();
+    void encode(const QueuedFrame &queued);
+    bool flushChunk();
+};
+
+/**
+ * @brief Memory mapped, read only view of a recording. read() is const and may be called from several threads.
+ */
+class RecordingReader {
+   public:
+    bool OK = false;
+    RecordingMetadata metadata;
+
+    RecordingReader(const std::string &filepath);
+    ~RecordingReader();
+    RecordingReader(const RecordingReader &) = delete;
+    RecordingReader &operator=(const RecordingReader &) = delete;
+
+    int frameCount() const;
+    int chunkCount() const;
+    cv::Range chunkFrames(int chunk) const;
+    bool read(int index, cv::Mat &frame, int64_t &timestampNs) const;
+
+   private:
+    int fd = -1;
+    const uchar *data = nullptr;
+    size_t size = 0;
+
+    std::vector<const uchar *> frameChunks;  // chunk start of every frame
+    std::vector<const RecordingFrameEntry *> frames;
+    std::vector<cv::Range> chunks;
+};
+
+bool isRecordingFile(const std::string &filepath);
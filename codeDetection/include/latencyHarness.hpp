@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "arucoSettings.hpp"
+#include "sceneGenerator.hpp"
+
+/**
+ * @brief End-to-end test settings: every trial sends a new code to the emulated firmware over its serial port and
+ *        times how long it takes until the detector reports that id
+ */
+struct LatencySettings {
+    std::string dict = "4_50";
+    int trials = 20;
+    char targetClr = 'r';
+    uint32_t color = 0xFF0000;
+    int brightness = 80;
+    bool ledGrid = false;  // decode with LedGridDecoder instead of the cv::aruco detector
+    double timeout = 2.0;  // seconds without detection before a trial counts as missed
+    uint64_t seed = 1;
+    std::string reportPath;                  // optional .yml | .xml | .json
+    const ArucoSettings *profile = nullptr;  // tuned detector profile, defaults when not set
+};
+
+std::string arucoSerialCode(int dictIndex, int id);
+bool runLatencyHarness(const LatencySettings &ls, const SceneSettings &ss);
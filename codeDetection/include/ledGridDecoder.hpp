@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "multiDictDetector.hpp"
+
+/**
+ * @brief Led dot detection and lattice fitting limits
+ */
+struct LedGridSettings {
+    int minDotArea = 3;              // pixels, smaller components are sensor noise
+    double maxDotAreaRate = 0.002;   // fraction of the frame, bigger components are not a single led
+    double linkRate = 2.6;           // dots closer than linkRate * (nearest neighbour distance) share a marker
+    double sampleRate = 0.15;        // half side of the window sampled on each module, as a fraction of the pitch
+    double maxErroneousBitsInBorderRate = 0.35;
+};
+
+/**
+ * @brief Decoder for markers shown on led matrices: lit leds are found as small components of the color mask,
+ *        grouped into markers, a homography is fitted to the led lattice and every module is sampled directly.
+ *        No morphology or adaptive thresholding is needed, the dots never have to merge into solid squares.
+ */
+class LedGridDecoder {
+   public:
+    LedGridSettings settings;
+
+    LedGridDecoder(const std::vector<std::string> &dictNames, LedGridSettings settings = LedGridSettings());
+
+    void detect(const cv::Mat &mask, std::vector<std::vector<cv::Point2f> > &corners, std::vector<int> &ids,
+                std::vector<int> &dictSlots) const;
+    const std::vector<std::string> &dictNames() const;
+
+   private:
+    MultiDictDetector codes;
+
+    void findDots(const cv::Mat &mask, std::vector<cv::Point2f> &dots) const;
+    void groupDots(const std::vector<cv::Point2f> &dots, std::vector<std::vector<cv::Point2f> > &groups) const;
+    bool decodeGroup(const cv::Mat &mask, const std::vector<cv::Point2f> &group, std::vector<cv::Point2f> &corners,
+                     CodeEntry &entry) const;
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+
+#include <opencv2/core.hpp>
+
+/**
+ * @brief Thresholds for deciding whether a frame changed enough to run the detection pipeline again
+ */
+struct MotionGateSettings {
+    int downscale = 8;           // frames are shrunk by this factor before being compared
+    int tileSize = 8;            // side of the compared tiles, in downscaled pixels
+    double tileThreshold = 6;    // mean absolute difference (8 bit levels) that marks a tile as changed
+    int maxChangedTiles = 0;     // more changed tiles than this and the frame is processed
+    int refreshInterval = 30;    // the full pipeline runs at least once every refreshInterval frames
+};
+
+/**
+ * @brief Cheap change detector run before the detection pipeline. Every frame is compared, tile by tile, with the
+ *        last frame that went through the pipeline; while nothing changes the previous detections can be reused.
+ */
+class MotionGate {
+   public:
+    MotionGateSettings settings;
+
+    long processedFrames = 0;
+    long reusedFrames = 0;
+    long forcedRefreshes = 0;
+
+    MotionGate(MotionGateSettings settings = MotionGateSettings());
+
+    bool needsProcessing(const cv::Mat &frame);
+    void invalidate();
+    std::string stats() const;
+
+   private:
+    cv::Mat reference;
+    int framesSinceRefresh = 0;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/aruco.hpp>
+
+/**
+ * @brief Marker a bit pattern decodes to (pattern may be up to maxCorrectionBits away from the real code)
+ */
+struct CodeEntry {
+    int dictSlot;
+    int id;
+    int rotation;
+    int distance;
+};
+
+/**
+ * @brief Detects markers of several dictionaries in a single pass. Quad candidates are extracted once per frame,
+ *        their bits are read once per grid size (4x4, 5x5, 6x6) and looked up in a precomputed index of every
+ *        (dictionary, id, rotation) and its neighbours within the allowed hamming distance. Adding a dictionary
+ *        with an already used grid size only grows the index. When several grid sizes are indexed a candidate must
+ *        have an error free border and decode at a single grid size. Corner refinement: none or subpix only.
+ */
+class MultiDictDetector {
+   public:
+    std::vector<std::string> dictNames;
+
+    MultiDictDetector(const std::vector<std::string> &dictNames, int maxCorrectionBits = 1);
+
+    void detect(const cv::Mat &image, const cv::Ptr<cv::aruco::DetectorParameters> &params,
+                std::vector<std::vector<cv::Point2f> > &corners, std::vector<int> &ids,
+                std::vector<int> &dictSlots) const;
+    bool lookup(int markerSize, uint64_t code, CodeEntry &entry) const;
+    std::vector<int> gridSizes() const;
+    size_t indexSize() const;
+
+    static bool parseDictList(const std::string &list, std::vector<std::string> &names);
+    static bool supportsCornerRefinement(int method);
+
+   private:
+    std::vector<cv::Ptr<cv::aruco::Dictionary> > dicts;
+    std::map<int, std::unordered_map<uint64_t, CodeEntry> > codeIndex;  // grid size -> bit pattern -> marker
+
+    void indexCode(int markerSize, uint64_t code, const CodeEntry &entry, int remainingFlips, int firstBit);
+    void findCandidates(const cv::Mat &gray, const cv::Ptr<cv::aruco::DetectorParameters> &params,
+                        std::vector<std::vector<cv::Point2f> > &candidates) const;
+    bool extractBits(const cv::Mat &gray, const std::vector<cv::Point2f> &candidate, int markerSize,
+                     const cv::Ptr<cv::aruco::DetectorParameters> &params, bool exactBorder, uint64_t &code) const;
+};
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "arucoSettings.hpp"
+
+/**
+ * @brief Detector parameter search settings. Frames come from a labeled recording or, by default, from the led
+ *        matrix emulator showing random ids.
+ */
+struct TunerSettings {
+    std::string recording;   // .carec file, empty = synthetic frames
+    std::string labelsPath;  // detections csv (--detections format) listing the ids expected on every frame
+    std::string dict = "4_50";
+    char targetClr = 'r';
+    float markerLength = 0;    // meters, 0 = the one stored in the recording
+    int frames = 60;           // synthetic frames
+    int candidates = 80;       // random parameter sets tried besides the current defaults
+    int timingPasses = 5;      // timed passes per candidate after a warm-up one, ms/frame is their median
+    double heldOutRate = 0.3;  // frames kept aside to check the chosen profile, never used by the search
+    double minRecall = 0;      // chosen profile: fastest with at least this recall (0 = best recall, then fastest)
+    uint64_t seed = 1;
+    std::string profilePath = ARUCO_PROFILE_PATH;
+    std::string reportPath;  // optional .yml | .xml | .json with every candidate and the front
+};
+
+bool runParamTuner(const TunerSettings &ts);
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <string>
+
+/**
+ * @brief Striped preprocessing benchmark settings: processFrameStriped() is timed with 1 .. maxThreads threads on
+ *        1080p and 4K synthetic frames and compared, bit for bit, with processFrame()
+ */
+struct PreprocessBenchSettings {
+    int maxThreads = 0;  // 0 = one per core
+    int repetitions = 10;
+    char targetClr = 'r';
+    std::string reportPath;  // optional .yml | .xml | .json
+};
+
+bool runPreprocessBenchmark(const PreprocessBenchSettings &bs);
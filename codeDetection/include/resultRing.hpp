@@ -0,0 +1,129 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+/*
+ * Detection results shared with other processes of the same host through POSIX shared memory.
+ *
+ *   RingHeader | RingSlot[capacity]
+ *
+ * One producer (the detector) and any number of consumers. Record n (n >= 1) goes to slot n % capacity; the slot
+ * sequence is 2n + 1 while the record is being written and 2n once it is complete, and head is the last complete
+ * record. Readers copy the record between two reads of the sequence and retry or report an overrun when it changed,
+ * nothing is ever locked and a slow consumer never holds the producer back.
+ *
+ * A new writer never resizes an existing ring: it unlinks the name and creates a fresh object, readers keep their
+ * mapping of the old one (no SIGBUS) and are told to reattach once it is closed or replaced (RING_STALE).
+ *
+ * This header and resultRing.cpp do not depend on OpenCV, consumers only need the arucoRing library.
+ */
+#define RESULT_RING_MAGIC 0x52524143u  // "CARR"
+#define RESULT_RING_VERSION 2
+#define RESULT_RING_DEFAULT_NAME "/colaruco_results"
+#define RESULT_RING_DEFAULT_CAPACITY 1024
+#define RESULT_RING_RECHECK_NS 100000000  // how often an idle reader checks whether its ring was replaced
+
+/**
+ * @brief One marker of one frame. A frame without markers is published as a single record with markerId -1 so
+ *        consumers also know when a marker disappeared.
+ */
+struct ResultRecord {
+    uint64_t frameId;
+    int64_t timestampNs;  // capture time (system clock)
+    int64_t publishNs;    // time the record was published (CLOCK_MONOTONIC), for latency measurements
+    int32_t markerId;     // -1: no marker on this frame
+    uint16_t markerIndex;
+    uint16_t markerCount;  // markers published for this frame
+    char dictName[12];
+    char colorChannel;  // r | g | b | w
+    uint8_t reused;     // pose carried over from a previous frame (motion gate)
+    uint8_t reserved[2];
+    float corners[8];  // x0 y0 .. x3 y3, pixels, cv::aruco order
+    double rvec[3];    // rodrigues rotation, camera frame
+    double tvec[3];    // meters, camera frame
+};
+
+struct alignas(64) RingSlot {
+    std::atomic<uint64_t> sequence;
+    ResultRecord record;
+};
+
+struct RingHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t capacity;
+    uint64_t generation;                     // creation time of this ring (CLOCK_MONOTONIC ns)
+    std::atomic<uint32_t> closed;            // set by the writer before the ring is unlinked
+    alignas(64) std::atomic<uint64_t> head;  // last complete record, 0 = none yet
+};
+
+static_assert(std::is_trivially_copyable_v<ResultRecord>);
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "the ring needs address free 64 bit atomics");
+
+int64_t monotonicNs();
+
+/**
+ * @brief Creates the shared memory object and publishes records into it. Unlinked again on destruction.
+ */
+class ResultRingWriter {
+   public:
+    bool OK = false;
+
+    ResultRingWriter(const std::string &name = RESULT_RING_DEFAULT_NAME,
+                     uint32_t capacity = RESULT_RING_DEFAULT_CAPACITY);
+    ~ResultRingWriter();
+    ResultRingWriter(const ResultRingWriter &) = delete;
+    ResultRingWriter &operator=(const ResultRingWriter &) = delete;
+
+    void publish(ResultRecord record);
+    uint64_t published() const;
+
+   private:
+    std::string name;
+    RingHeader *header = nullptr;
+    RingSlot *slots = nullptr;
+    size_t mappedBytes = 0;
+    uint64_t inode = 0;  // to only unlink the name if it still is this ring
+};
+
+// RING_STALE: everything was read and the writer closed the ring or a new one replaced it, call reattach()
+enum RingReadStatus { RING_EMPTY, RING_RECORD, RING_OVERRUN, RING_STALE };
+
+/**
+ * @brief Consumer side: maps an existing ring read only and walks its records in order
+ */
+class ResultRingReader {
+   public:
+    bool OK = false;
+
+    ResultRingReader(const std::string &name = RESULT_RING_DEFAULT_NAME);
+    ~ResultRingReader();
+    ResultRingReader(const ResultRingReader &) = delete;
+    ResultRingReader &operator=(const ResultRingReader &) = delete;
+
+    RingReadStatus next(ResultRecord &record);
+    bool reattach();
+    void seekLatest();
+    uint64_t lostRecords() const;
+    uint32_t capacity() const;
+    uint64_t generation() const;
+
+   private:
+    std::string name;
+    const RingHeader *header = nullptr;
+    const RingSlot *slots = nullptr;
+    size_t mappedBytes = 0;
+    uint64_t inode = 0;
+    int64_t lastCheckNs = 0;
+    uint64_t nextSequence = 1;
+    uint64_t lost = 0;
+
+    bool attach(bool verbose);
+    void detach();
+    bool replaced();
+};
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "resultRing.hpp"
+
+/**
+ * @brief Result ring test settings: a producer publishes paced records, every consumer maps the ring on its own and
+ *        measures publish to read latency, then a burst checks that overruns are reported
+ */
+struct RingLatencySettings {
+    int records = 10000;   // paced phase, about 5 s at the default rate
+    double rateHz = 2000;  // publishing rate of the paced phase
+    int consumers = 2;
+    uint32_t capacity = RESULT_RING_DEFAULT_CAPACITY;
+    std::string reportPath;  // optional .yml | .xml | .json
+};
+
+bool runRingLatencyTest(const RingLatencySettings &rs);
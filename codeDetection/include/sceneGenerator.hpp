@@ -0,0 +1,73 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+
+#include "firmwareEmulator.hpp"
+
+/**
+ * @brief Virtual camera and led matrix properties used to render synthetic frames
+ */
+struct SceneSettings {
+    cv::Size frameSize = cv::Size(1280, 720);
+    double focalLength = 1000;  // pixels
+    double fps = 30;
+
+    double ledPitch = 0.0166;    // meters between neighbouring leds (60 leds/m strip)
+    double dotRadius = 0.25;     // lit area of each led, as a fraction of the pitch
+    double distance = 0.6;       // meters from the camera to the matrix
+    cv::Vec3d tilt{0.25, -0.2, 0.05};  // matrix orientation (rodrigues vector)
+    cv::Vec2d offset{0.0, 0.0};        // matrix center offset from the optical axis (meters)
+
+    double exposure = 1.0;       // sensor gain, leds saturate above 1
+    double ledGain = 2.5;        // how much brighter a led core is than its nominal color
+    double glow = 0.6;           // strength of the halo around each led
+    double blurSigma = 1.0;      // optical blur (pixels)
+    double noiseSigma = 3.0;     // sensor noise (8 bit levels)
+    cv::Scalar ambient{18, 16, 14};  // background BGR level
+
+    uint64_t seed = 1;
+};
+
+/**
+ * @brief Renders the firmware led strip as glowing dots seen through a pinhole camera
+ */
+class SceneGenerator {
+   public:
+    SceneSettings settings;
+
+    SceneGenerator(SceneSettings settings);
+
+    void render(const LedStripState &strip, cv::Mat &frame);
+    cv::Mat cameraMatrix() const;
+    cv::Mat distortionCoeffs() const;
+
+    static cv::Point ledPosition(int stripIndex);
+
+   private:
+    cv::RNG rng;
+};
+
+/**
+ * @brief cv::VideoCapture that grabs frames from a SceneGenerator fed by a FirmwareEmulator, so it can be handed to
+ *        arucoRecLoop() in place of a camera. Frames are paced at settings.fps.
+ */
+class SyntheticCapture : public cv::VideoCapture {
+   public:
+    SceneGenerator generator;
+
+    SyntheticCapture(FirmwareEmulator &emulator, SceneSettings settings);
+
+    bool isOpened() const override;
+    bool grab() override;
+    bool retrieve(cv::OutputArray image, int flag = 0) override;
+    bool read(cv::OutputArray image) override;
+
+   private:
+    FirmwareEmulator &emulator;
+    LedStripState grabbedStrip;
+    std::chrono::steady_clock::time_point nextFrame;
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Fixed set of worker threads that run numbered tasks (frame stripes) and wait for all of them.
+ *        The calling thread works too, so a pool of n threads starts n - 1 workers.
+ */
+class StripePool {
+   public:
+    StripePool(int threads = 0);  // 0 = one per core
+    ~StripePool();
+    StripePool(const StripePool &) = delete;
+    StripePool &operator=(const StripePool &) = delete;
+
+    int threadCount() const;
+    void run(int taskCount, const std::function<void(int)> &task);
+
+   private:
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(int)> *job = nullptr;
+    int jobTasks = 0;
+    std::atomic<int> nextTask = 0;
+    int busyWorkers = 0;
+    unsigned long generation = 0;
+    bool stopping = false;
+
+    void workerLoop();
+    void drain();
+};
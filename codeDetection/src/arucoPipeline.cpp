@@ -0,0 +1,256 @@
+#include "../include/arucoPipeline.hpp"
+
+#include <algorithm>
+
+#include <opencv2/opencv.hpp>
+
+#define BILATERAL_DIAMETER 5
+
+// ####################################################################################################################
+
+cv::Ptr<cv::aruco::DetectorParameters> ARUCO_PARAMS = cv::aruco::DetectorParameters::create();
+
+const std::map<std::string, int> supportedArucoTypes{
+    {"4_50", cv::aruco::DICT_4X4_50},
+    {"4_100", cv::aruco::DICT_4X4_100},
+    {"4_250", cv::aruco::DICT_4X4_250},
+    {"4_1000", cv::aruco::DICT_4X4_1000},
+    {"5_50", cv::aruco::DICT_5X5_50},
+    {"5_100", cv::aruco::DICT_5X5_100},
+    {"5_250", cv::aruco::DICT_5X5_250},
+    {"5_1000", cv::aruco::DICT_5X5_1000},
+    {"6_50", cv::aruco::DICT_6X6_50},
+    {"6_100", cv::aruco::DICT_6X6_100},
+    {"6_250", cv::aruco::DICT_6X6_250},
+    {"6_1000", cv::aruco::DICT_6X6_1000},
+    {"original", cv::aruco::DICT_ARUCO_ORIGINAL},
+};
+
+// ####################################################################################################################
+
+void maskFrame(const cv::Mat &inFrame, cv::Mat &outFrame, char targetClr, int delta) {
+    cv::Mat bgr[3];
+    cv::split(inFrame, bgr);
+
+    std::map<char, cv::Mat> clrChannels{{'r', bgr[2]}, {'g', bgr[1]}, {'b', bgr[0]}};
+
+    cv::Mat targetCh = clrChannels[targetClr];
+    cv::Mat color1, color2;
+
+    for (auto pair : clrChannels) {
+        if (pair.first == targetClr)
+            continue;
+        if (color1.empty())
+            color1 = clrChannels[pair.first];
+        else
+            color2 = clrChannels[pair.first];
+    }
+
+    cv::Mat colorMask = (targetCh > (color1 + delta)) & (targetCh > (color2 + delta));
+    cv::Mat falsePositives = (color1 < 255 - delta) & (color2 < 255 - delta);
+
+    outFrame = cv::Mat::zeros(targetCh.rows, targetCh.cols, targetCh.type());
+    outFrame = (255 * (colorMask & falsePositives));
+}
+
+void processFrame(const cv::Mat &inFrame, cv::Mat &outFrame, char targetClr, cv::Size kSize, int delta) {
+    // normal color for the codes -- handled by default by openCV
+    if (targetClr == 'w')
+        return cv::cvtColor(inFrame, outFrame, cv::COLOR_BGR2GRAY);
+
+    // run a bilateralFilter to blur the original image - helps reducing noise for future masking
+    cv::bilateralFilter(inFrame, outFrame, BILATERAL_DIAMETER, 75, 90);  //! needs revision
+
+    // threshold image relative to the selected color channel
+    maskFrame(outFrame, outFrame, targetClr, delta);
+
+    // kernels for dilation and erosion operations
+    cv::Mat dilKernel = cv::getStructuringElement(cv::MORPH_ELLIPSE, kSize);
+    cv::Mat erKernel = cv::getStructuringElement(cv::MORPH_RECT, kSize);
+
+    //image dilation and erosion for eliminating noise created by the color mask
+    cv::dilate(outFrame, outFrame, dilKernel);
+    cv::erode(outFrame, outFrame, erKernel);
+}
+
+/**
+ * @brief same result as processFrame(), bit for bit, computed over horizontal stripes on a thread pool.
+ *        Every stripe is processed with enough extra rows above and below (halo) to cover the reach of the
+ *        bilateral filter, the dilation and the erosion, and only its own rows are copied to the output.
+ *
+ * @param pool threads the stripes are spread over
+ * @param stripeCount number of stripes, 0 = one per pool thread
+ */
+void processFrameStriped(const cv::Mat &inFrame, cv::Mat &outFrame, char targetClr, StripePool &pool,
+                         cv::Size kSize, int delta, int stripeCount) {
+    int halo = 0;
+    if (targetClr != 'w') {
+        // anchors are centered, a kernel reaches k/2 rows up and k - 1 - k/2 rows down
+        int morphReach = std::max(kSize.height / 2, kSize.height - 1 - kSize.height / 2);
+        halo = BILATERAL_DIAMETER / 2 + 2 * morphReach;
+    }
+
+    cv::Mat in = inFrame;  // keeps the input alive if outFrame is the same matrix
+    int rows = in.rows;
+    int stripes = std::clamp(stripeCount > 0 ? stripeCount : pool.threadCount(), 1, std::max(1, rows));
+
+    outFrame.create(rows, in.cols, CV_8UC1);
+    cv::Mat out = outFrame;  // the lambda must not resize the caller's matrix
+
+    pool.run(stripes, [&](int stripe) {
+        int first = rows * stripe / stripes, last = rows * (stripe + 1) / stripes;
+        int haloFirst = std::max(0, first - halo), haloLast = std::min(rows, last + halo);
+
+        // the stripe is a standalone copy so its top and bottom rows are treated like image borders by every
+        // filter - what they get wrong stays inside the halo
+        cv::Mat stripeIn = in.rowRange(haloFirst, haloLast).clone(), stripeOut;
+        processFrame(stripeIn, stripeOut, targetClr, kSize, delta);
+        stripeOut.rowRange(first - haloFirst, last - haloFirst).copyTo(out.rowRange(first, last));
+    });
+}
+
+/**
+ * @brief color mask for the led grid decoder - the leds stay separate dots, so no denoising or morphology is done
+ *
+ */
+void processLedFrame(const cv::Mat &inFrame, cv::Mat &outFrame, char targetClr, int delta) {
+    if (targetClr == 'w') {
+        cv::cvtColor(inFrame, outFrame, cv::COLOR_BGR2GRAY);
+        cv::threshold(outFrame, outFrame, 0, 255, cv::THRESH_BINARY | cv::THRESH_OTSU);
+        return;
+    }
+
+    maskFrame(inFrame, outFrame, targetClr, delta);
+}
+
+/**
+ * @brief draw marker outlines, ids and axes on the frame
+ *
+ */
+void drawMarkers(CameraSettings cs, cv::Mat &original, const std::vector<MarkerDetection> &detections, float mLen) {
+    std::vector<int> ids;
+    std::vector<std::vector<cv::Point2f> > corners;
+
+    if (detections.empty())
+        return;
+
+    for (auto &detection : detections) {
+        ids.push_back(detection.id);
+        corners.push_back(detection.corners);
+    }
+    cv::aruco::drawDetectedMarkers(original, corners, ids);
+
+    for (auto &detection : detections)
+        cv::aruco::drawAxis(original, cs.cameraMatrix, cs.distortionCoeffs, detection.rvec, detection.tvec, mLen / 3);
+}
+
+static void estimatePoses(CameraSettings &cs, cv::Mat &original, std::vector<std::vector<cv::Point2f> > &corners,
+                          std::vector<int> &ids, float mLen, std::vector<MarkerDetection> &detections) {
+    std::vector<cv::Vec3d> rvecs, tvecs;
+
+    detections.clear();
+
+    if (not corners.empty()) {
+        cv::aruco::estimatePoseSingleMarkers(corners, mLen, cs.cameraMatrix, cs.distortionCoeffs, rvecs, tvecs);
+
+        for (int i = 0; i < rvecs.size(); i++)
+            detections.push_back({ids[i], corners[i], rvecs[i], tvecs[i]});
+    }
+
+    drawMarkers(cs, original, detections, mLen);
+}
+
+void detectMarkers(CameraSettings cs, cv::Mat &original, cv::Mat &masked, cv::Ptr<cv::aruco::Dictionary> dict,
+                   float mLen, std::vector<MarkerDetection> &detections,
+                   cv::Ptr<cv::aruco::DetectorParameters> params) {
+    std::vector<int> ids;
+    std::vector<std::vector<cv::Point2f> > corners, rejected;
+
+    cv::aruco::detectMarkers(masked, dict, corners, ids, params, rejected, cs.cameraMatrix, cs.distortionCoeffs);
+    estimatePoses(cs, original, corners, ids, mLen, detections);
+}
+
+/**
+ * @brief same as detectMarkers() but for every dictionary of a MultiDictDetector at once
+ *
+ */
+void detectMarkers(CameraSettings cs, cv::Mat &original, cv::Mat &masked, const MultiDictDetector &detector,
+                   float mLen, std::vector<MarkerDetection> &detections,
+                   cv::Ptr<cv::aruco::DetectorParameters> params) {
+    std::vector<int> ids, dictSlots;
+    std::vector<std::vector<cv::Point2f> > corners;
+
+    detector.detect(masked, params, corners, ids, dictSlots);
+    estimatePoses(cs, original, corners, ids, mLen, detections);
+
+    for (int i = 0; i < detections.size(); i++)
+        detections[i].dictName = detector.dictNames[dictSlots[i]];
+}
+
+/**
+ * @brief same as detectMarkers() but decoding the led lattice directly from a processLedFrame() mask
+ *
+ */
+void detectMarkers(CameraSettings cs, cv::Mat &original, cv::Mat &masked, const LedGridDecoder &decoder,
+                   float mLen, std::vector<MarkerDetection> &detections) {
+    std::vector<int> ids, dictSlots;
+    std::vector<std::vector<cv::Point2f> > corners;
+
+    decoder.detect(masked, corners, ids, dictSlots);
+    estimatePoses(cs, original, corners, ids, mLen, detections);
+
+    for (int i = 0; i < detections.size(); i++)
+        detections[i].dictName = decoder.dictNames()[dictSlots[i]];
+}
+
+/**
+ * @brief initial config of the frame loop from the command line choices
+ *
+ * @param dict single dictionary, also the led decoder's one when dictList is empty
+ * @param dictList comma separated dictionaries detected at once (ignored when empty, validated by the caller)
+ * @param ledGrid decode the led lattice instead of running the cv::aruco detector
+ */
+void makeDetectionConfig(const std::string &dict, const std::string &dictList, bool ledGrid, char targetClr,
+                         DetectionConfig &config) {
+    config.targetClr = targetClr;
+    config.dictName = dict;
+    config.dict = cv::aruco::getPredefinedDictionary(supportedArucoTypes.at(dict));
+    config.params = cv::makePtr<cv::aruco::DetectorParameters>(*ARUCO_PARAMS);
+
+    std::vector<std::string> dictNames{dict}, listed;
+    if (MultiDictDetector::parseDictList(dictList, listed)) {
+        dictNames = listed;
+        config.dictName = dictList;
+        config.multiDict = cv::makePtr<MultiDictDetector>(dictNames);
+    }
+
+    if (ledGrid)
+        config.ledDecoder = cv::makePtr<LedGridDecoder>(dictNames);
+}
+
+static void preprocess(const cv::Mat &frame, cv::Mat &masked, const DetectionConfig &config) {
+    if (config.stripePool)
+        processFrameStriped(frame, masked, config.targetClr, *config.stripePool, config.kernelSize, config.delta);
+    else
+        processFrame(frame, masked, config.targetClr, config.kernelSize, config.delta);
+}
+
+/**
+ * @brief run the whole pipeline (mask, detection, poses) selected by the config on a single frame
+ *
+ * @param frame capture, markers are drawn on it
+ * @param masked color mask the markers were detected on
+ */
+void detectFrame(CameraSettings cs, const DetectionConfig &config, cv::Mat &frame, cv::Mat &masked, float mLen,
+                 std::vector<MarkerDetection> &detections) {
+    if (config.ledDecoder) {
+        processLedFrame(frame, masked, config.targetClr, config.delta);
+        detectMarkers(cs, frame, masked, *config.ledDecoder, mLen, detections);
+    } else if (config.multiDict) {
+        preprocess(frame, masked, config);
+        detectMarkers(cs, frame, masked, *config.multiDict, mLen, detections, config.params);
+    } else {
+        preprocess(frame, masked, config);
+        detectMarkers(cs, frame, masked, config.dict, mLen, detections, config.params);
+    }
+}
@@ -1,7 +1,97 @@
 #include "../include/arucoSettings.hpp"
 
+#include <iostream>
+
 using namespace std;
 
 ArucoSettings::ArucoSettings() {
     arucoParams = cv::aruco::DetectorParameters::create();
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Load a detector profile (see save()), missing keys keep their default value
+ *
+ * @param filepath .yml | .xml | .json written by the parameter tuner
+ */
+ArucoSettings::ArucoSettings(string filepath) : ArucoSettings() {
+    cv::FileStorage fs;
+    if (not fs.open(filepath, cv::FileStorage::READ)) {
+        this->OK = false;
+        return;
+    }
+
+    auto readInt = [&fs](const char *key, int &value) {
+        if (not fs[key].empty())
+            fs[key] >> value;
+    };
+    auto readDouble = [&fs](const char *key, double &value) {
+        if (not fs[key].empty())
+            fs[key] >> value;
+    };
+
+    readInt("adaptiveThreshWinSizeMin", arucoParams->adaptiveThreshWinSizeMin);
+    readInt("adaptiveThreshWinSizeMax", arucoParams->adaptiveThreshWinSizeMax);
+    readInt("adaptiveThreshWinSizeStep", arucoParams->adaptiveThreshWinSizeStep);
+    readDouble("adaptiveThreshConstant", arucoParams->adaptiveThreshConstant);
+    readDouble("polygonalApproxAccuracyRate", arucoParams->polygonalApproxAccuracyRate);
+    readDouble("minMarkerPerimeterRate", arucoParams->minMarkerPerimeterRate);
+    readDouble("maxMarkerPerimeterRate", arucoParams->maxMarkerPerimeterRate);
+    readInt("cornerRefinementMethod", arucoParams->cornerRefinementMethod);
+    readInt("cornerRefinementWinSize", arucoParams->cornerRefinementWinSize);
+    readInt("cornerRefinementMaxIterations", arucoParams->cornerRefinementMaxIterations);
+    readDouble("cornerRefinementMinAccuracy", arucoParams->cornerRefinementMinAccuracy);
+    readInt("delta", delta);
+    readInt("kernelSize", kernelSize.width);
+    kernelSize.height = kernelSize.width;
+
+    if (arucoParams->adaptiveThreshWinSizeMin < 3 or
+        arucoParams->adaptiveThreshWinSizeMax < arucoParams->adaptiveThreshWinSizeMin or
+        arucoParams->adaptiveThreshWinSizeStep < 1 or kernelSize.width < 1) {
+        cout << "[ERROR] Invalid detector profile (loaded from: " << filepath << "), using the defaults" << endl;
+        arucoParams = cv::aruco::DetectorParameters::create();
+        delta = DELTA;
+        kernelSize = cv::Size(10, 10);
+        this->OK = false;
+        return;
+    }
+
+    cout << "[INFO] detector profile loaded from " << filepath << "\n";
+}
+
+/**
+ * @brief Write the detector parameters, mask delta and kernel size (same keys as cv::aruco::DetectorParameters)
+ *
+ */
+bool ArucoSettings::save(string filepath) const {
+    cv::FileStorage fs(filepath, cv::FileStorage::WRITE);
+    if (not fs.isOpened()) {
+        cout << "[ERROR] could not open specified file (" << filepath << ") " << endl;
+        return false;
+    }
+
+    fs << "adaptiveThreshWinSizeMin" << arucoParams->adaptiveThreshWinSizeMin
+       << "adaptiveThreshWinSizeMax" << arucoParams->adaptiveThreshWinSizeMax
+       << "adaptiveThreshWinSizeStep" << arucoParams->adaptiveThreshWinSizeStep
+       << "adaptiveThreshConstant" << arucoParams->adaptiveThreshConstant
+       << "polygonalApproxAccuracyRate" << arucoParams->polygonalApproxAccuracyRate
+       << "minMarkerPerimeterRate" << arucoParams->minMarkerPerimeterRate
+       << "maxMarkerPerimeterRate" << arucoParams->maxMarkerPerimeterRate
+       << "cornerRefinementMethod" << arucoParams->cornerRefinementMethod
+       << "cornerRefinementWinSize" << arucoParams->cornerRefinementWinSize
+       << "cornerRefinementMaxIterations" << arucoParams->cornerRefinementMaxIterations
+       << "cornerRefinementMinAccuracy" << arucoParams->cornerRefinementMinAccuracy
+       << "delta" << delta
+       << "kernelSize" << kernelSize.width;
+
+    return true;
+}
+
+/**
+ * @brief use these settings for the frame loop (the params are copied, live changes do not touch this profile)
+ *
+ */
+void ArucoSettings::apply(DetectionConfig &config) const {
+    config.params = cv::makePtr<cv::aruco::DetectorParameters>(*arucoParams);
+    config.delta = delta;
+    config.kernelSize = kernelSize;
+}
@@ -0,0 +1,205 @@
+#include "../include/batchProcessor.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+#include <opencv2/imgcodecs.hpp>
+
+#include "../include/cameraSettings.hpp"
+#include "../include/detectionLog.hpp"
+#include "../include/frameRecording.hpp"
+
+#define BATCH_IMAGES_PER_UNIT 32
+
+/**
+ * @brief A recording or an image directory, with what is needed to estimate poses on its frames
+ */
+struct BatchSource {
+    std::string name;
+    cv::Ptr<RecordingReader> recording;
+    std::vector<std::string> images;
+    cv::Mat cameraMatrix;
+    cv::Mat distortionCoeffs;
+    float markerLength = 0;
+};
+
+/**
+ * @brief Frames handed to a worker at once - a recording chunk or BATCH_IMAGES_PER_UNIT images
+ */
+struct BatchUnit {
+    int source;
+    cv::Range frames;
+};
+
+/**
+ * @brief first calibration profile of a calibration file (see CameraSettings::saveCalibrationResults())
+ *
+ */
+static bool loadCalibration(const std::string &filepath, cv::Mat &cameraMatrix, cv::Mat &distortionCoeffs) {
+    cv::FileStorage fs;
+    if (filepath.empty() or not fs.open(filepath, cv::FileStorage::READ))
+        return false;
+
+    fs["device1"]["Camera_Matrix"] >> cameraMatrix;
+    fs["device1"]["Distortion_Coefficients"] >> distortionCoeffs;
+    return not(cameraMatrix.empty() or distortionCoeffs.empty());
+}
+
+static bool openSource(const std::string &input, const BatchSettings &bs, BatchSource &source) {
+    source.name = input;
+    source.markerLength = bs.markerLength;
+
+    if (isRecordingFile(input)) {
+        source.recording = cv::makePtr<RecordingReader>(input);
+        if (not source.recording->OK)
+            return false;
+
+        source.cameraMatrix = source.recording->metadata.cameraMatrix;
+        source.distortionCoeffs = source.recording->metadata.distortionCoeffs;
+        if (source.markerLength <= 0)
+            source.markerLength = source.recording->metadata.markerLength;
+    } else if (std::filesystem::is_directory(input)) {
+        const std::vector<std::string> extensions{".png", ".jpg", ".jpeg", ".bmp", ".tif", ".tiff"};
+        for (auto &entry : std::filesystem::directory_iterator(input)) {
+            std::string extension = entry.path().extension().string();
+            std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+            if (entry.is_regular_file() and
+                std::find(extensions.begin(), extensions.end(), extension) != extensions.end())
+                source.images.push_back(entry.path().string());
+        }
+        std::sort(source.images.begin(), source.images.end());
+    } else {
+        std::cout << "[ERROR] " << input << " is neither a recording (.carec) nor an image directory\n";
+        return false;
+    }
+
+    if (source.cameraMatrix.empty() and
+        not loadCalibration(bs.calibrationPath, source.cameraMatrix, source.distortionCoeffs)) {
+        std::cout << "[ERROR] no calibration for " << input << " (--calibration=<file>)\n";
+        return false;
+    }
+
+    if (source.markerLength <= 0) {
+        std::cout << "[ERROR] unknown marker size for " << input << " (--ms=x, x > 0)\n";
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief decoded, writable copy of a source frame
+ *
+ */
+static bool readFrame(const BatchSource &source, int index, cv::Mat &frame, int64_t &timestampNs) {
+    if (source.recording) {
+        cv::Mat mapped;
+        if (not source.recording->read(index, mapped, timestampNs))
+            return false;
+        frame = mapped.clone();  // raw frames point into the read only mapping, markers are drawn on the frame
+    } else {
+        frame = cv::imread(source.images[index], cv::IMREAD_COLOR);
+        timestampNs = -1;  // image files carry no capture time
+    }
+
+    return not frame.empty();
+}
+
+/**
+ * @brief Run the detection pipeline over every frame of every input, split across worker threads. Output only
+ *        depends on the inputs and settings: motion gating is off, each frame is processed on its own and records
+ *        are written in source/frame order whatever thread handled them.
+ *
+ * @param bs inputs, output and pipeline choices
+ * @return true if every input could be opened and read
+ */
+bool runBatch(const BatchSettings &bs) {
+    DetectionConfig config;
+    makeDetectionConfig(bs.dict, bs.dictList, bs.ledGrid, bs.targetClr, config);
+    if (bs.profile)
+        bs.profile->apply(config);
+
+    std::vector<BatchSource> sources(bs.inputs.size());
+    std::vector<BatchUnit> units;
+
+    for (int i = 0; i < bs.inputs.size(); i++) {
+        if (not openSource(bs.inputs[i], bs, sources[i]))
+            return false;
+
+        if (sources[i].recording) {
+            for (int chunk = 0; chunk < sources[i].recording->chunkCount(); chunk++)
+                units.push_back({i, sources[i].recording->chunkFrames(chunk)});
+        } else {
+            for (int first = 0; first < sources[i].images.size(); first += BATCH_IMAGES_PER_UNIT)
+                units.push_back({i, cv::Range(first, std::min<int>(first + BATCH_IMAGES_PER_UNIT,
+                                                                   sources[i].images.size()))});
+        }
+    }
+
+    DetectionLog log(bs.outputPath);
+    if (not log.OK)
+        return false;
+
+    int nThreads = bs.threads > 0 ? bs.threads : std::max(1u, std::thread::hardware_concurrency());
+    nThreads = std::max(1, std::min<int>(nThreads, units.size()));
+
+    // parallelism is across frames, opencv's own threads would only compete with the workers
+    int cvThreads = cv::getNumThreads();
+    cv::setNumThreads(1);
+
+    std::vector<std::string> records(units.size());
+    std::atomic<int> nextUnit = 0;
+    std::atomic<long> frameCount = 0, markerCount = 0, unreadable = 0;
+
+    auto worker = [&]() {
+        cv::Mat frame, maskedFrame;
+        std::vector<MarkerDetection> detections;
+
+        for (int u = nextUnit++; u < units.size(); u = nextUnit++) {
+            const BatchSource &source = sources[units[u].source];
+            CameraSettings cs(source.cameraMatrix, source.distortionCoeffs);
+
+            for (int i = units[u].frames.start; i < units[u].frames.end; i++) {
+                int64_t timestampNs;
+                if (not readFrame(source, i, frame, timestampNs)) {
+                    unreadable++;
+                    continue;
+                }
+
+                detectFrame(cs, config, frame, maskedFrame, source.markerLength, detections);
+                records[u] += DetectionLog::format(source.name, i, timestampNs, config.dictName, detections);
+
+                frameCount++;
+                markerCount += detections.size();
+            }
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < nThreads; t++)
+        workers.emplace_back(worker);
+    for (auto &thread : workers)
+        thread.join();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    cv::setNumThreads(cvThreads);
+
+    for (auto &unitRecords : records)
+        log.write(unitRecords);
+
+    std::cout << std::fixed << std::setprecision(2) << "[INFO] Batch: " << frameCount << " frames from "
+              << sources.size() << " source(s), " << markerCount << " markers, " << nThreads << " threads, "
+              << seconds << " s (" << (seconds > 0 ? frameCount / seconds : 0) << " frames/s)\n";
+
+    if (unreadable > 0)
+        std::cout << "[WARNING] " << unreadable << " frames could not be read\n";
+
+    return unreadable == 0;
+}
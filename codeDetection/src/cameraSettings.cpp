@@ -106,6 +106,18 @@ CameraSettings::CameraSettings(string filepath) {
     this->OK = true;
 }
 
+/**
+ * @brief Use already known intrinsics (synthetic or recorded frame sources) - no capture device is searched for
+ * 
+ * @param camMatrix 
+ * @param distCoeffs 
+ */
+CameraSettings::CameraSettings(cv::Mat camMatrix, cv::Mat distCoeffs) {
+    this->cameraMatrix = camMatrix;
+    this->distortionCoeffs = distCoeffs;
+    this->OK = not(camMatrix.empty() or distCoeffs.empty());
+}
+
 bool CameraSettings::saveCalibrationResults(string filepath, cv::Mat camMatrix, cv::Mat distCoeffs) {
     if (not filenameIsValid(filepath)) {
         cout << INVALID_PATH_ERROR_MSG << endl;
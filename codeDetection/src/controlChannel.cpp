@@ -0,0 +1,347 @@
+#include "../include/controlChannel.hpp"
+
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define CONTROL_POLL_MS 100
+#define CONTROL_MAX_LINE 4096  // a socket client that sends more without a newline is dropped
+
+struct TunableParam {
+    double min;
+    double max;
+    std::function<void(cv::aruco::DetectorParameters &, double)> set;
+};
+
+// detector parameters that may be changed live, with their accepted range
+static const std::map<std::string, TunableParam> tunableParams{
+    {"adaptiveThreshWinSizeMin", {3, 255, [](auto &p, double v) { p.adaptiveThreshWinSizeMin = v; }}},
+    {"adaptiveThreshWinSizeMax", {3, 255, [](auto &p, double v) { p.adaptiveThreshWinSizeMax = v; }}},
+    {"adaptiveThreshWinSizeStep", {1, 255, [](auto &p, double v) { p.adaptiveThreshWinSizeStep = v; }}},
+    {"adaptiveThreshConstant", {-255, 255, [](auto &p, double v) { p.adaptiveThreshConstant = v; }}},
+    {"minMarkerPerimeterRate", {0, 4, [](auto &p, double v) { p.minMarkerPerimeterRate = v; }}},
+    {"maxMarkerPerimeterRate", {0, 4, [](auto &p, double v) { p.maxMarkerPerimeterRate = v; }}},
+    {"polygonalApproxAccuracyRate", {0, 1, [](auto &p, double v) { p.polygonalApproxAccuracyRate = v; }}},
+    {"minCornerDistanceRate", {0, 1, [](auto &p, double v) { p.minCornerDistanceRate = v; }}},
+    {"minDistanceToBorder", {0, 1000, [](auto &p, double v) { p.minDistanceToBorder = v; }}},
+    {"minMarkerDistanceRate", {0, 1, [](auto &p, double v) { p.minMarkerDistanceRate = v; }}},
+    {"cornerRefinementMethod", {cv::aruco::CORNER_REFINE_NONE, cv::aruco::CORNER_REFINE_APRILTAG,
+                                [](auto &p, double v) { p.cornerRefinementMethod = v; }}},
+    {"cornerRefinementWinSize", {1, 100, [](auto &p, double v) { p.cornerRefinementWinSize = v; }}},
+    {"cornerRefinementMaxIterations", {1, 1000, [](auto &p, double v) { p.cornerRefinementMaxIterations = v; }}},
+    {"cornerRefinementMinAccuracy", {0, 10, [](auto &p, double v) { p.cornerRefinementMinAccuracy = v; }}},
+    {"perspectiveRemovePixelPerCell", {1, 100, [](auto &p, double v) { p.perspectiveRemovePixelPerCell = v; }}},
+    {"perspectiveRemoveIgnoredMarginPerCell", {0, 0.5, [](auto &p, double v) { p.perspectiveRemoveIgnoredMarginPerCell = v; }}},
+    {"maxErroneousBitsInBorderRate", {0, 1, [](auto &p, double v) { p.maxErroneousBitsInBorderRate = v; }}},
+    {"minOtsuStdDev", {0, 255, [](auto &p, double v) { p.minOtsuStdDev = v; }}},
+    {"errorCorrectionRate", {0, 1, [](auto &p, double v) { p.errorCorrectionRate = v; }}},
+};
+
+/**
+ * @brief Start the stdin reader and, when a path is given, a unix socket listener
+ *
+ * @param initial config the frame loop starts with
+ * @param socketPath unix socket to listen on (empty for stdin only)
+ */
+ControlChannel::ControlChannel(const DetectionConfig &initial, std::string socketPath)
+    : socketPath(socketPath), latest(initial) {
+    this->stdinThread = std::thread(&ControlChannel::stdinLoop, this);
+
+    if (socketPath.empty())
+        return;
+
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(addr.sun_path)) {
+        std::cout << "[ERROR] control socket path is too long (" << socketPath << ")\n";
+        this->OK = false;
+        return;
+    }
+    socketPath.copy(addr.sun_path, socketPath.size());
+
+    unlink(socketPath.c_str());  // stale socket from a previous run
+    this->listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (this->listenFd < 0 or bind(this->listenFd, (sockaddr *)&addr, sizeof(addr)) != 0 or listen(this->listenFd, 4) != 0) {
+        std::cout << "[ERROR] Unable to open the control socket (" << socketPath << ")\n";
+        this->OK = false;
+        return;
+    }
+
+    std::cout << "[INFO] Control socket listening on " << socketPath << "\n";
+    this->socketThread = std::thread(&ControlChannel::socketLoop, this);
+}
+
+ControlChannel::~ControlChannel() {
+    this->running = false;
+
+    if (this->stdinThread.joinable())
+        this->stdinThread.join();
+    if (this->socketThread.joinable())
+        this->socketThread.join();
+
+    if (this->listenFd >= 0) {
+        close(this->listenFd);
+        unlink(this->socketPath.c_str());
+    }
+}
+
+/**
+ * @brief called by the frame loop at the start of every frame - only takes the lock when a new config is waiting
+ *
+ * @param config updated in place with the newest accepted config
+ * @return true if config changed
+ */
+bool ControlChannel::poll(DetectionConfig &config) {
+    if (not this->pending.load(std::memory_order_acquire))
+        return false;
+
+    std::lock_guard<std::mutex> lock(this->configMutex);
+    config = this->latest;
+    this->pending.store(false, std::memory_order_release);
+    return true;
+}
+
+bool ControlChannel::quitRequested() const {
+    return this->quit;
+}
+
+/**
+ * @brief validate and stage a single command
+ *
+ * @param line command line
+ * @param reply message for whoever sent the command
+ * @return true if the command was accepted
+ */
+bool ControlChannel::execute(const std::string &line, std::string &reply) {
+    std::istringstream in(line);
+    std::string cmd, arg;
+    in >> cmd;
+
+    if (cmd.empty())
+        return true;
+
+    if (cmd == "help" or cmd == "-h" or cmd == "--help") {
+        std::stringstream ss;
+        ss << "commands: dict <type> | dicts <type,type,...> | decoder <aruco/led> | color <r/g/b/w> | "
+           << "delta <0-255> | param <name> <value> | show | quit\n"
+           << "supported dict values:";
+        for (auto pair : supportedArucoTypes)
+            ss << " " << pair.first;
+        ss << "\ntunable detector params:";
+        for (auto &pair : tunableParams)
+            ss << " " << pair.first;
+        reply = ss.str();
+        return true;
+    }
+
+    if (cmd == "quit" or cmd == "q") {
+        this->quit = true;
+        reply = "[INFO] quit requested";
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(this->configMutex);
+
+    if (cmd == "show") {
+        auto &p = *this->latest.params;
+        std::stringstream ss;
+        ss << "dict " << this->latest.dictName << " | decoder " << (this->latest.ledDecoder ? "led" : "aruco")
+           << " | color " << this->latest.targetClr << " | delta "
+           << this->latest.delta << " | adaptiveThreshWinSize " << p.adaptiveThreshWinSizeMin << ":"
+           << p.adaptiveThreshWinSizeStep << ":" << p.adaptiveThreshWinSizeMax << " | polygonalApproxAccuracyRate "
+           << p.polygonalApproxAccuracyRate << " | cornerRefinementMethod " << p.cornerRefinementMethod;
+        reply = ss.str();
+        return true;
+    }
+
+    // every change builds a new config (and a new parameter object) so the one in use by the frame loop is never
+    // written to
+    DetectionConfig next = this->latest;
+    next.params = cv::makePtr<cv::aruco::DetectorParameters>(*this->latest.params);
+
+    if (cmd == "dict") {
+        in >> arg;
+        if (not supportedArucoTypes.contains(arg)) {
+            reply = "[ERROR] aruco tag of type {dict" + arg + "} is not supported";
+            return false;
+        }
+        next.dictName = arg;
+        next.dict = cv::aruco::getPredefinedDictionary(supportedArucoTypes.at(arg));
+        next.multiDict = nullptr;
+    } else if (cmd == "dicts") {
+        std::vector<std::string> names;
+        in >> arg;
+        if (not MultiDictDetector::parseDictList(arg, names)) {
+            reply = "[ERROR] dicts must be a comma separated list of supported types (ex: 4_50,5_50,original)";
+            return false;
+        }
+        // the code index is built here, on the reader thread
+        next.dictName = arg;
+        next.multiDict = cv::makePtr<MultiDictDetector>(names);
+    } else if (cmd == "decoder") {
+        in >> arg;
+        if (arg != "aruco" and arg != "led") {
+            reply = "[ERROR] decoder must be aruco or led";
+            return false;
+        }
+        next.ledDecoder = nullptr;
+    } else if (cmd == "color") {
+        in >> arg;
+        if (arg.size() != 1 or std::string("rgbw").find(arg[0]) == std::string::npos) {
+            reply = "[ERROR] color channel must be one of r/g/b/w";
+            return false;
+        }
+        next.targetClr = arg[0];
+    } else if (cmd == "delta") {
+        int delta;
+        if (not(in >> delta) or delta < 0 or delta > 255) {
+            reply = "[ERROR] delta must be an integer within [0, 255]";
+            return false;
+        }
+        next.delta = delta;
+    } else if (cmd == "param") {
+        double value;
+        in >> arg;
+        if (not tunableParams.contains(arg)) {
+            reply = "[ERROR] unknown detector param (" + arg + ")";
+            return false;
+        }
+        auto &param = tunableParams.at(arg);
+        if (not(in >> value) or value < param.min or value > param.max) {
+            reply = "[ERROR] invalid value for " + arg;
+            return false;
+        }
+        param.set(*next.params, value);
+
+        if (next.params->adaptiveThreshWinSizeMin > next.params->adaptiveThreshWinSizeMax or
+            next.params->minMarkerPerimeterRate > next.params->maxMarkerPerimeterRate) {
+            reply = "[ERROR] " + arg + " would leave an empty min/max range";
+            return false;
+        }
+    } else {
+        reply = "[ERROR] unknown command (" + cmd + "), try help";
+        return false;
+    }
+
+    if (next.multiDict and not MultiDictDetector::supportsCornerRefinement(next.params->cornerRefinementMethod)) {
+        reply = "[WARNING] rejected, several dictionaries only support none or subpix corner refinement";
+        return false;
+    }
+
+    // the led decoder follows the dictionary list, rebuilt whenever it changes
+    if ((cmd == "decoder" and arg == "led") or ((cmd == "dict" or cmd == "dicts") and next.ledDecoder)) {
+        std::vector<std::string> names{next.dictName};
+        if (next.multiDict)
+            names = next.multiDict->dictNames;
+        next.ledDecoder = cv::makePtr<LedGridDecoder>(names);
+    }
+
+    this->latest = next;
+    this->pending.store(true, std::memory_order_release);
+    reply = "[INFO] " + line + " -> applied on next frame";
+    return true;
+}
+
+void ControlChannel::stdinLoop() {
+    std::string buffer;
+
+    while (this->running) {
+        pollfd pfd{STDIN_FILENO, POLLIN, 0};
+        if (::poll(&pfd, 1, CONTROL_POLL_MS) <= 0)
+            continue;
+
+        char chunk[256];
+        ssize_t n = read(STDIN_FILENO, chunk, sizeof(chunk));
+        if (n <= 0)
+            return;  // stdin closed, the socket (if any) keeps working
+
+        buffer.append(chunk, n);
+
+        size_t end;
+        while ((end = buffer.find('\n')) != std::string::npos) {
+            std::string reply;
+            execute(buffer.substr(0, end), reply);
+            buffer.erase(0, end + 1);
+
+            if (not reply.empty())
+                std::cout << reply << std::endl;
+        }
+    }
+}
+
+/**
+ * @brief serve every connected client from a single poll set - a client whose recv or send fails is closed and
+ *        dropped from the set, the others keep being served
+ *
+ */
+void ControlChannel::socketLoop() {
+    std::vector<pollfd> fds{{this->listenFd, POLLIN, 0}};
+    std::vector<std::string> buffers{""};  // pending partial line of every fd, same order as fds
+
+    auto drop = [&](size_t i) {
+        close(fds[i].fd);
+        fds.erase(fds.begin() + i);
+        buffers.erase(buffers.begin() + i);
+    };
+
+    while (this->running) {
+        if (::poll(fds.data(), fds.size(), CONTROL_POLL_MS) <= 0)
+            continue;
+
+        // clients first, backwards so that dropping one does not shift the ones still to be checked
+        for (size_t i = fds.size() - 1; i > 0; i--) {
+            if (fds[i].revents == 0)
+                continue;
+
+            char chunk[256];
+            ssize_t n = recv(fds[i].fd, chunk, sizeof(chunk), 0);
+            if (n <= 0) {
+                drop(i);
+                continue;
+            }
+
+            std::string &buffer = buffers[i];
+            buffer.append(chunk, n);
+
+            size_t end;
+            bool failed = false;
+            while (not failed and (end = buffer.find('\n')) != std::string::npos) {
+                std::string reply;
+                execute(buffer.substr(0, end), reply);
+                buffer.erase(0, end + 1);
+
+                reply += "\n";
+                failed = send(fds[i].fd, reply.data(), reply.size(), MSG_NOSIGNAL) < 0;
+            }
+
+            // what is left is an unfinished line
+            if (not failed and buffer.size() > CONTROL_MAX_LINE) {
+                std::cout << "[WARNING] control client dropped, no newline in " << buffer.size() << " bytes\n";
+                failed = true;
+            }
+
+            if (failed)
+                drop(i);
+        }
+
+        if (fds[0].revents & POLLIN) {
+            int clientFd = accept(this->listenFd, nullptr, nullptr);
+            if (clientFd >= 0) {
+                fds.push_back({clientFd, POLLIN, 0});
+                buffers.emplace_back();
+            }
+        }
+    }
+
+    for (size_t i = fds.size() - 1; i > 0; i--)
+        drop(i);
+}
@@ -0,0 +1,78 @@
+#include "../include/detectionLog.hpp"
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#define DETECTION_LOG_HEADER                                                                                \
+    "source,frame,timestamp_ns,dict,id,reused,x0,y0,x1,y1,x2,y2,x3,y3,rvec_x,rvec_y,rvec_z,tvec_x,tvec_y," \
+    "tvec_z\n"
+
+#define DETECTION_LOG_FLUSH_MS 1000
+
+DetectionLog::DetectionLog(const std::string &filepath) {
+    this->file.open(filepath, std::ios::out | std::ios::trunc);
+    if (not this->file.is_open()) {
+        std::cout << "[ERROR] could not create detection log " << filepath << std::endl;
+        return;
+    }
+
+    this->file << DETECTION_LOG_HEADER;
+    this->lastFlush = std::chrono::steady_clock::now();
+    this->OK = this->file.good();
+}
+
+/**
+ * @brief append records - they reach the file on the next timed flush, not on every frame
+ *
+ */
+void DetectionLog::write(const std::string &records) {
+    if (not this->OK)
+        return;
+
+    this->file << records;
+
+    auto now = std::chrono::steady_clock::now();
+    if (now - this->lastFlush >= std::chrono::milliseconds(DETECTION_LOG_FLUSH_MS)) {
+        this->file.flush();
+        this->lastFlush = now;
+    }
+}
+
+void DetectionLog::close() {
+    if (this->file.is_open())
+        this->file.close();
+    this->OK = false;
+}
+
+/**
+ * @brief records of all the markers of a frame
+ *
+ * @param source camera, recording or image directory the frame came from
+ * @param frameIndex frame number within the source
+ * @param timestampNs capture time, -1 when unknown
+ * @param dictName used for detections that do not carry their own dictionary
+ * @return std::string one line per marker (empty when nothing was detected)
+ */
+std::string DetectionLog::format(const std::string &source, long frameIndex, int64_t timestampNs,
+                                 const std::string &dictName, const std::vector<MarkerDetection> &detections) {
+    std::stringstream ss;
+    ss << std::fixed;
+
+    for (auto &detection : detections) {
+        ss << source << "," << frameIndex << "," << timestampNs << ","
+           << (detection.dictName.empty() ? dictName : detection.dictName) << "," << detection.id << ","
+           << detection.reused << std::setprecision(3);
+        for (auto &corner : detection.corners)
+            ss << "," << corner.x << "," << corner.y;
+
+        ss << std::setprecision(6);
+        for (int i = 0; i < 3; i++)
+            ss << "," << detection.rvec[i];
+        for (int i = 0; i < 3; i++)
+            ss << "," << detection.tvec[i];
+        ss << "\n";
+    }
+
+    return ss.str();
+}
@@ -0,0 +1,269 @@
+#include "../include/firmwareEmulator.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#define OFF 0x000000
+#define BIT(n) (1 << (n))
+
+#define SERIAL_TIMEOUT_MS 50
+
+static bool isNumber(const std::string &token) {
+    if (token.empty())
+        return false;
+    char *end;
+    std::strtol(token.c_str(), &end, 10);
+    return *end == '\0';
+}
+
+/**
+ * @brief Open a pseudo terminal pair and start the emulated firmware on the master side
+ *
+ */
+FirmwareEmulator::FirmwareEmulator() {
+    this->masterFd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (this->masterFd < 0 or grantpt(this->masterFd) != 0 or unlockpt(this->masterFd) != 0) {
+        std::cout << "[ERROR] Unable to create a pseudo terminal for the firmware emulator\n";
+        return;
+    }
+
+    char name[128];
+    if (ptsname_r(this->masterFd, name, sizeof(name)) != 0) {
+        std::cout << "[ERROR] Unable to resolve the firmware emulator serial port\n";
+        return;
+    }
+    this->slaveName = name;
+
+    // keeping the slave side open avoids hangups on the master each time a client closes the port
+    this->slaveFd = open(name, O_RDWR | O_NOCTTY);
+    if (this->slaveFd < 0) {
+        std::cout << "[ERROR] Unable to open the firmware emulator serial port (" << name << ")\n";
+        return;
+    }
+
+    termios tty;
+    tcgetattr(this->slaveFd, &tty);
+    cfmakeraw(&tty);
+    tcsetattr(this->slaveFd, TCSANOW, &tty);
+
+    // like a real uart, whatever is printed while nobody reads the port is lost instead of blocking the firmware
+    fcntl(this->masterFd, F_SETFL, fcntl(this->masterFd, F_GETFL) | O_NONBLOCK);
+
+    serialPrint("\r\n\r\nColAruco connection to serial port online\r\n\r\n");
+
+    this->running = true;
+    this->serialThread = std::thread(&FirmwareEmulator::serialLoop, this);
+    this->OK = true;
+}
+
+FirmwareEmulator::~FirmwareEmulator() {
+    this->running = false;
+    if (this->serialThread.joinable())
+        this->serialThread.join();
+
+    if (this->slaveFd >= 0)
+        close(this->slaveFd);
+    if (this->masterFd >= 0)
+        close(this->masterFd);
+}
+
+std::string FirmwareEmulator::portName() const {
+    return this->slaveName;
+}
+
+LedStripState FirmwareEmulator::snapshot() {
+    std::lock_guard<std::mutex> lock(this->stripMutex);
+    return this->strip;
+}
+
+/**
+ * @brief reads the serial port and splits it into whitespace separated tokens. A token that is not followed by
+ *        whitespace is flushed once the line is idle (same as the arduino Stream timeout)
+ *
+ */
+void FirmwareEmulator::serialLoop() {
+    std::string pending;
+
+    while (this->running) {
+        pollfd pfd{this->masterFd, POLLIN, 0};
+        int ready = poll(&pfd, 1, SERIAL_TIMEOUT_MS);
+
+        if (ready > 0 and (pfd.revents & POLLIN)) {
+            char buffer[256];
+            ssize_t n = read(this->masterFd, buffer, sizeof(buffer));
+
+            for (ssize_t i = 0; i < n; i++) {
+                if (std::isspace(static_cast<unsigned char>(buffer[i]))) {
+                    if (not pending.empty())
+                        this->tokens.push_back(pending);
+                    pending.clear();
+                } else
+                    pending += buffer[i];
+            }
+        } else if (not pending.empty()) {
+            this->tokens.push_back(pending);
+            pending.clear();
+        }
+
+        int inputResult;
+        while ((inputResult = inputParser()) != 0) {
+            reportState();
+
+            if (inputResult == -1) {
+                serialPrint(" --- testing led strip --- \r\n");
+                testLedStrip();
+                std::this_thread::sleep_for(std::chrono::milliseconds(2000));
+            }
+
+            applyAruco();
+        }
+    }
+}
+
+/**
+ * @brief port of the firmware inputParser() - consumes one command from the token queue
+ *
+ * @return 1 if any values were updated, -1 for a strip test, 0 if there is no complete command queued
+ */
+int FirmwareEmulator::inputParser() {
+    while (not this->tokens.empty()) {
+        std::string flag = this->tokens.front();
+
+        // numeric arguments that follow the flag (non numeric tokens are skipped, like Serial.parseInt())
+        std::vector<long> values;
+        std::vector<size_t> positions;
+        for (size_t i = 1; i < this->tokens.size(); i++)
+            if (isNumber(this->tokens[i])) {
+                values.push_back(std::strtol(this->tokens[i].c_str(), nullptr, 10));
+                positions.push_back(i);
+            }
+
+        if (flag.find("test") != std::string::npos) {
+            this->tokens.pop_front();
+            return -1;
+        }
+
+        if (flag.find("save") != std::string::npos) {
+            this->tokens.pop_front();
+            this->savedColor = this->colorOnDisplay;
+            this->savedBrightness = this->brightnessOnDisplay;
+            this->savedSize = this->arucoCodeSize;
+            std::copy(std::begin(this->arucoOnDisplay), std::end(this->arucoOnDisplay), this->savedAruco);
+            serialPrint("\r\nCurrent settings saved to EEPROM storage.\r\n\r\n");
+            return 1;
+        }
+
+        if (flag.find("load") != std::string::npos) {
+            this->tokens.pop_front();
+            this->colorOnDisplay = this->savedColor;
+            this->brightnessOnDisplay = this->savedBrightness;
+            this->arucoCodeSize = this->savedSize;
+            std::copy(std::begin(this->savedAruco), std::end(this->savedAruco), this->arucoOnDisplay);
+            serialPrint("\r\nPrevious settings loaded from EEPROM storage.\r\n\r\n");
+            return 1;
+        }
+
+        if (flag.find("code") != std::string::npos) {
+            if (values.empty())
+                return 0;
+
+            uint8_t size = std::min<long>(static_cast<uint8_t>(values[0]), LINE_LED_COUNT);
+            if (values.size() < size + 1u)
+                return 0;
+
+            this->arucoCodeSize = size;
+            for (short i = 0; i < size; i++)
+                this->arucoOnDisplay[i] = static_cast<uint8_t>(values[i + 1]);
+
+            this->tokens.erase(this->tokens.begin(), this->tokens.begin() + positions[size] + 1);
+            return 1;
+        }
+
+        if (flag.find("br") != std::string::npos) {
+            if (values.empty())
+                return 0;
+
+            this->brightnessOnDisplay = static_cast<uint8_t>(values[0]);
+            this->tokens.erase(this->tokens.begin(), this->tokens.begin() + positions[0] + 1);
+            return 1;
+        }
+
+        if (flag.find("cl") != std::string::npos) {
+            if (this->tokens.size() < 2)
+                return 0;
+
+            this->colorOnDisplay = std::strtoul(this->tokens[1].substr(0, 6).c_str(), nullptr, 16);
+            this->tokens.erase(this->tokens.begin(), this->tokens.begin() + 2);
+            return 1;
+        }
+
+        // unknown flags are dropped by the firmware
+        this->tokens.pop_front();
+    }
+    return 0;
+}
+
+void FirmwareEmulator::reportState() {
+    std::stringstream ss;
+    ss << "Brightness value: " << std::dec << (int)this->brightnessOnDisplay << "\r\n"
+       << "Color on display: " << std::hex << std::uppercase << this->colorOnDisplay << std::dec << "\r\n"
+       << "Aruco code size : " << (int)this->arucoCodeSize << "\r\n"
+       << "Aruco code on display (bytes): ";
+    for (short i = 0; i < this->arucoCodeSize; i++)
+        ss << (int)this->arucoOnDisplay[i] << " ";
+    ss << "\r\n";
+
+    serialPrint(ss.str());
+}
+
+void FirmwareEmulator::serialPrint(const std::string &text) {
+    if (write(this->masterFd, text.data(), text.size()) < 0 and errno != EAGAIN)
+        std::cout << "[ERROR] firmware emulator failed to write to its serial port\n";
+}
+
+/**
+ * @brief port of the firmware applyAruco() - odd lines of the strip run backwards (serpentine wiring)
+ *
+ */
+void FirmwareEmulator::applyAruco() {
+    std::lock_guard<std::mutex> lock(this->stripMutex);
+
+    this->strip.pixels.fill(OFF);
+    this->strip.brightness = this->brightnessOnDisplay;
+
+    uint8_t size = this->arucoCodeSize;
+    uint8_t *code = this->arucoOnDisplay;
+    uint32_t color = this->colorOnDisplay;
+
+    for (short line = 0; line < size; line++) {
+        if (line % 2) {
+            char offset = LINE_LED_COUNT - size;  //To offset odd lines and align the matrix properly to the left
+
+            for (short col = size - 1; col >= 0; col--)
+                this->strip.pixels[line * LINE_LED_COUNT + col + offset] = (code[line] & BIT(col)) ? color : OFF;
+        } else
+            for (short col = 0; col < size; col++)
+                this->strip.pixels[line * LINE_LED_COUNT + col] = (code[line] & BIT((size - col - 1))) ? color : OFF;
+    }
+
+    this->strip.revision++;
+}
+
+void FirmwareEmulator::testLedStrip() {
+    std::lock_guard<std::mutex> lock(this->stripMutex);
+
+    this->strip.pixels.fill(0xffffff);
+    this->strip.brightness = 255;
+    this->strip.revision++;
+}
@@ -0,0 +1,341 @@
+#include "../include/frameRecording.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <opencv2/imgcodecs.hpp>
+
+static uint64_t alignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+static void writePadding(std::ofstream &file, uint64_t bytes) {
+    static const char zeros[RECORDING_ALIGNMENT] = {};
+    while (bytes > 0) {
+        uint64_t n = std::min<uint64_t>(bytes, sizeof(zeros));
+        file.write(zeros, n);
+        bytes -= n;
+    }
+}
+
+bool isRecordingFile(const std::string &filepath) {
+    return filepath.ends_with(".carec");
+}
+
+// ####################################################################################################################
+
+/**
+ * @brief Create (or overwrite) a recording
+ *
+ * @param filepath .carec file
+ * @param metadata calibration and marker size of the source, so the recording can be processed on its own later
+ * @param settings chunk size and frame encoding
+ */
+RecordingWriter::RecordingWriter(const std::string &filepath, const RecordingMetadata &metadata,
+                                 RecordingSettings settings)
+    : settings(settings) {
+    if (not isRecordingFile(filepath)) {
+        std::cout << "[ERROR] recordings must use the .carec extension (" << filepath << ")\n";
+        return;
+    }
+
+    this->file.open(filepath, std::ios::binary | std::ios::trunc);
+    if (not this->file.is_open()) {
+        std::cout << "[ERROR] could not create recording " << filepath << std::endl;
+        return;
+    }
+
+    cv::FileStorage fs(".yml", cv::FileStorage::WRITE | cv::FileStorage::MEMORY);
+    fs << "Camera_Matrix" << metadata.cameraMatrix;
+    fs << "Distortion_Coefficients" << metadata.distortionCoeffs;
+    fs << "Marker_Length" << metadata.markerLength;
+    fs << "Source" << metadata.source;
+    std::string yaml = fs.releaseAndGetString();
+
+    RecordingFileHeader header{};
+    std::memcpy(header.magic, RECORDING_MAGIC, sizeof(header.magic));
+    header.version = RECORDING_VERSION;
+    header.metadataBytes = yaml.size();
+
+    this->file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    this->file.write(yaml.data(), yaml.size());
+    uint64_t headerBytes = sizeof(header) + yaml.size();
+    writePadding(this->file, alignUp(headerBytes, RECORDING_ALIGNMENT) - headerBytes);
+
+    this->OK = this->file.good();
+    if (this->OK)
+        this->writerThread = std::thread(&RecordingWriter::writerLoop, this);
+}
+
+RecordingWriter::~RecordingWriter() {
+    close();
+}
+
+/**
+ * @brief queue a copy of the frame for the writer thread, the chunk is written once it holds
+ *        settings.framesPerChunk frames
+ *
+ * @param frame any continuous or non continuous cv::Mat, may be drawn on right after the call
+ * @param timestampNs capture time
+ * @return false if the frame was dropped (queue full) or the recording can no longer be written
+ */
+bool RecordingWriter::write(const cv::Mat &frame, int64_t timestampNs) {
+    if (not this->OK or this->failed or frame.empty())
+        return false;
+
+    {
+        std::lock_guard<std::mutex> lock(this->queueMutex);
+        if (this->queue.size() >= std::max(1, settings.queueFrames)) {
+            this->dropped++;
+            return false;
+        }
+    }
+
+    // the copy is made outside of the lock, only this thread adds frames
+    QueuedFrame queued{frame.clone(), timestampNs};
+    {
+        std::lock_guard<std::mutex> lock(this->queueMutex);
+        this->queue.push_back(std::move(queued));
+    }
+    this->queueReady.notify_one();
+    return true;
+}
+
+void RecordingWriter::writerLoop() {
+    while (true) {
+        QueuedFrame queued;
+        {
+            std::unique_lock<std::mutex> lock(this->queueMutex);
+            this->queueReady.wait(lock, [this]() { return this->closing or not this->queue.empty(); });
+            if (this->queue.empty())
+                return;  // closing, and every queued frame was written
+
+            queued = std::move(this->queue.front());
+            this->queue.pop_front();
+        }
+
+        if (not this->failed)
+            encode(queued);
+    }
+}
+
+/**
+ * @brief writer thread side of write(): encode the frame and add it to the current chunk
+ *
+ */
+void RecordingWriter::encode(const QueuedFrame &queued) {
+    const cv::Mat &frame = queued.frame;
+    RecordingFrameEntry entry{queued.timestampNs, 0, 0, frame.rows, frame.cols, frame.type(), FRAME_RAW};
+    std::vector<uchar> payload;
+
+    if (settings.compress) {
+        entry.encoding = FRAME_PNG;
+        cv::imencode(".png", frame, payload, {cv::IMWRITE_PNG_COMPRESSION, settings.pngLevel});
+    } else {
+        cv::Mat continuous = frame.isContinuous() ? frame : frame.clone();
+        payload.assign(continuous.data, continuous.data + continuous.total() * continuous.elemSize());
+    }
+
+    entry.bytes = payload.size();
+    this->entries.push_back(entry);
+    this->payloads.push_back(std::move(payload));
+    this->writtenFrames++;
+
+    if (this->entries.size() >= std::max(1, settings.framesPerChunk))
+        flushChunk();
+}
+
+bool RecordingWriter::flushChunk() {
+    if (this->entries.empty())
+        return true;
+
+    uint64_t offset = sizeof(RecordingChunkHeader) + this->entries.size() * sizeof(RecordingFrameEntry);
+    for (auto &entry : this->entries) {
+        entry.offset = alignUp(offset, RECORDING_PAYLOAD_ALIGNMENT);
+        offset = entry.offset + entry.bytes;
+    }
+
+    RecordingChunkHeader header{};
+    std::memcpy(header.magic, RECORDING_CHUNK_MAGIC, sizeof(header.magic));
+    header.frameCount = this->entries.size();
+    header.chunkBytes = alignUp(offset, RECORDING_ALIGNMENT);
+
+    this->file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    this->file.write(reinterpret_cast<const char *>(this->entries.data()),
+                     this->entries.size() * sizeof(RecordingFrameEntry));
+
+    uint64_t position = sizeof(header) + this->entries.size() * sizeof(RecordingFrameEntry);
+    for (int i = 0; i < this->entries.size(); i++) {
+        writePadding(this->file, this->entries[i].offset - position);
+        this->file.write(reinterpret_cast<const char *>(this->payloads[i].data()), this->payloads[i].size());
+        position = this->entries[i].offset + this->entries[i].bytes;
+    }
+    writePadding(this->file, header.chunkBytes - position);
+
+    this->entries.clear();
+    this->payloads.clear();
+
+    if (not this->file.good()) {
+        std::cout << "[ERROR] failed to write recording chunk\n";
+        this->failed = true;
+    }
+    return not this->failed;
+}
+
+/**
+ * @brief write the frames still queued and the last (partial) chunk, then close the file
+ *
+ */
+void RecordingWriter::close() {
+    if (not this->file.is_open())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(this->queueMutex);
+        this->closing = true;
+    }
+    this->queueReady.notify_one();
+    if (this->writerThread.joinable())
+        this->writerThread.join();
+
+    if (not this->failed)
+        flushChunk();
+    this->file.close();
+    this->OK = false;
+
+    if (this->dropped > 0)
+        std::cout << "[WARNING] " << this->dropped << " frames were not recorded (writer thread fell behind)\n";
+}
+
+long RecordingWriter::frameCount() const {
+    return this->writtenFrames;
+}
+
+long RecordingWriter::droppedFrames() const {
+    return this->dropped;
+}
+
+// ####################################################################################################################
+
+/**
+ * @brief Map a recording and index its chunks. A truncated last chunk is ignored.
+ *
+ * @param filepath .carec file
+ */
+RecordingReader::RecordingReader(const std::string &filepath) {
+    this->fd = open(filepath.c_str(), O_RDONLY);
+    if (this->fd < 0) {
+        std::cout << "[ERROR] could not open recording " << filepath << std::endl;
+        return;
+    }
+
+    struct stat st;
+    if (fstat(this->fd, &st) != 0 or st.st_size < sizeof(RecordingFileHeader)) {
+        std::cout << "[ERROR] " << filepath << " is not a recording\n";
+        return;
+    }
+
+    void *mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, this->fd, 0);
+    if (mapping == MAP_FAILED) {
+        std::cout << "[ERROR] could not map recording " << filepath << std::endl;
+        return;
+    }
+    this->data = static_cast<const uchar *>(mapping);
+    this->size = st.st_size;
+
+    auto header = reinterpret_cast<const RecordingFileHeader *>(this->data);
+    if (std::memcmp(header->magic, RECORDING_MAGIC, sizeof(header->magic)) != 0 or
+        header->version != RECORDING_VERSION or sizeof(*header) + header->metadataBytes > this->size) {
+        std::cout << "[ERROR] " << filepath << " is not a supported recording\n";
+        return;
+    }
+
+    std::string yaml(reinterpret_cast<const char *>(this->data + sizeof(*header)), header->metadataBytes);
+    cv::FileStorage fs(yaml, cv::FileStorage::READ | cv::FileStorage::MEMORY);
+    fs["Camera_Matrix"] >> metadata.cameraMatrix;
+    fs["Distortion_Coefficients"] >> metadata.distortionCoeffs;
+    fs["Marker_Length"] >> metadata.markerLength;
+    fs["Source"] >> metadata.source;
+
+    uint64_t position = alignUp(sizeof(*header) + header->metadataBytes, RECORDING_ALIGNMENT);
+    while (position + sizeof(RecordingChunkHeader) <= this->size) {
+        const uchar *chunk = this->data + position;
+        auto chunkHeader = reinterpret_cast<const RecordingChunkHeader *>(chunk);
+
+        if (std::memcmp(chunkHeader->magic, RECORDING_CHUNK_MAGIC, sizeof(chunkHeader->magic)) != 0 or
+            chunkHeader->chunkBytes == 0 or position + chunkHeader->chunkBytes > this->size or
+            sizeof(*chunkHeader) + chunkHeader->frameCount * sizeof(RecordingFrameEntry) > chunkHeader->chunkBytes) {
+            std::cout << "[WARNING] " << filepath << " ends with an incomplete chunk, it is skipped\n";
+            break;
+        }
+
+        auto entries = reinterpret_cast<const RecordingFrameEntry *>(chunk + sizeof(*chunkHeader));
+        int first = this->frames.size();
+        for (int i = 0; i < chunkHeader->frameCount; i++) {
+            if (entries[i].offset + entries[i].bytes > chunkHeader->chunkBytes)
+                break;
+            this->frames.push_back(&entries[i]);
+            this->frameChunks.push_back(chunk);
+        }
+        this->chunks.push_back(cv::Range(first, this->frames.size()));
+
+        position += chunkHeader->chunkBytes;
+    }
+
+    this->OK = true;
+}
+
+RecordingReader::~RecordingReader() {
+    if (this->data)
+        munmap(const_cast<uchar *>(this->data), this->size);
+    if (this->fd >= 0)
+        ::close(this->fd);
+}
+
+int RecordingReader::frameCount() const {
+    return this->frames.size();
+}
+
+int RecordingReader::chunkCount() const {
+    return this->chunks.size();
+}
+
+/**
+ * @brief frame indexes [start, end) stored in a chunk
+ *
+ */
+cv::Range RecordingReader::chunkFrames(int chunk) const {
+    return this->chunks[chunk];
+}
+
+/**
+ * @brief get a frame and its capture time
+ *
+ * @param index 0 .. frameCount() - 1
+ * @param frame raw frames point straight into the mapping and must not be written to (clone() them first)
+ * @param timestampNs capture time, -1 when unknown
+ */
+bool RecordingReader::read(int index, cv::Mat &frame, int64_t &timestampNs) const {
+    if (index < 0 or index >= this->frames.size())
+        return false;
+
+    const RecordingFrameEntry &entry = *this->frames[index];
+    uchar *payload = const_cast<uchar *>(this->frameChunks[index] + entry.offset);
+    timestampNs = entry.timestampNs;
+
+    if (entry.encoding == FRAME_RAW) {
+        if (entry.bytes != uint64_t(entry.rows) * entry.cols * CV_ELEM_SIZE(entry.type))
+            return false;
+        frame = cv::Mat(entry.rows, entry.cols, entry.type, payload);
+    } else {
+        frame = cv::imdecode(cv::Mat(1, entry.bytes, CV_8U, payload), cv::IMREAD_UNCHANGED);
+    }
+
+    return not frame.empty() and frame.rows == entry.rows and frame.cols == entry.cols;
+}
@@ -0,0 +1,222 @@
+#include "../include/latencyHarness.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <opencv2/aruco.hpp>
+
+#include "../include/arucoPipeline.hpp"
+#include "../include/cameraSettings.hpp"
+
+struct TrialResult {
+    int id;
+    bool detected;
+    double latencyMs;
+    int frames;
+    int wrongIds;
+};
+
+/**
+ * @brief serial command that displays the marker on the firmware - same encoding as fetch_aruco() in colAruco.py
+ *        (one byte per marker row, border included, most significant bit on the left)
+ *
+ * @param dictIndex cv::aruco predefined dictionary
+ * @param id marker id
+ * @return std::string
+ */
+std::string arucoSerialCode(int dictIndex, int id) {
+    auto dict = cv::aruco::getPredefinedDictionary(dictIndex);
+    int sidePixels = dict->markerSize + 2;
+
+    cv::Mat marker;
+    cv::aruco::drawMarker(dict, id, sidePixels, marker);
+
+    std::stringstream ss;
+    ss << "code " << sidePixels;
+    for (int i = 0; i < marker.rows; i++) {
+        int rowBits = 0;
+        for (int j = 0; j < marker.cols; j++)
+            if (marker.at<uchar>(i, j))
+                rowBits += 1 << (marker.cols - j - 1);
+        ss << " " << rowBits;
+    }
+    ss << " ";
+
+    return ss.str();
+}
+
+static double percentile(std::vector<double> sorted, double p) {
+    if (sorted.empty())
+        return 0;
+    return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))];
+}
+
+/**
+ * @brief Drive the emulated firmware through its serial port and time the detection of every new code
+ *
+ * @param ls trial settings
+ * @param ss scene rendering settings
+ * @return true if the harness ran (regardless of the recall obtained)
+ */
+bool runLatencyHarness(const LatencySettings &ls, const SceneSettings &ss) {
+    using clock = std::chrono::steady_clock;
+
+    if (not supportedArucoTypes.contains(ls.dict)) {
+        std::cout << "[FATAL] aruco tag of type {dict" << ls.dict << "} is not supported\n";
+        return false;
+    }
+
+    FirmwareEmulator emulator;
+    if (not emulator.OK)
+        return false;
+
+    SyntheticCapture vidCap(emulator, ss);
+    CameraSettings cs(vidCap.generator.cameraMatrix(), vidCap.generator.distortionCoeffs());
+
+    int port = open(emulator.portName().c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (port < 0) {
+        std::cout << "[FATAL] Unable to open the firmware emulator serial port (" << emulator.portName() << ")\n";
+        return false;
+    }
+
+    auto serialWrite = [port](const std::string &command) {
+        if (write(port, command.data(), command.size()) < 0)
+            std::cout << "[ERROR] Unable to write to the firmware emulator serial port\n";
+    };
+
+    int dictIndex = supportedArucoTypes.at(ls.dict);
+    auto arucoDict = cv::aruco::getPredefinedDictionary(dictIndex);
+    float mLen = (arucoDict->markerSize + 2) * ss.ledPitch;
+
+    // same pipeline as the live loop, profile included
+    DetectionConfig config;
+    makeDetectionConfig(ls.dict, "", ls.ledGrid, ls.targetClr, config);
+    if (ls.profile)
+        ls.profile->apply(config);
+
+    std::stringstream setup;
+    setup << "br " << ls.brightness << " cl " << std::hex << std::setw(6) << std::setfill('0') << ls.color << " ";
+    serialWrite(setup.str());
+
+    cv::RNG rng(ls.seed);
+    cv::Mat frame, maskedFrame;
+    std::vector<MarkerDetection> detections;
+    std::vector<TrialResult> results;
+    double processingMs = 0;
+    int processedFrames = 0;
+    int previousId = -1;
+
+    std::cout << "[INFO] Running " << ls.trials << " latency trials (dict " << ls.dict << ", color channel "
+              << ls.targetClr << ") on " << emulator.portName() << "\n";
+
+    for (int trial = 0; trial < ls.trials; trial++) {
+        int id;
+        do
+            id = rng.uniform(0, arucoDict->bytesList.rows);
+        while (id == previousId);
+        previousId = id;
+
+        TrialResult result{id, false, 0, 0, 0};
+
+        serialWrite(arucoSerialCode(dictIndex, id));
+        auto start = clock::now();
+
+        while (clock::now() - start < std::chrono::duration<double>(ls.timeout)) {
+            vidCap.read(frame);
+
+            auto processStart = clock::now();
+            detectFrame(cs, config, frame, maskedFrame, mLen, detections);
+            processingMs += std::chrono::duration<double, std::milli>(clock::now() - processStart).count();
+            processedFrames++;
+            result.frames++;
+
+            bool found = false;
+            for (auto &detection : detections) {
+                if (detection.id == id)
+                    found = true;
+                else
+                    result.wrongIds++;
+            }
+
+            if (found) {
+                result.detected = true;
+                result.latencyMs = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+                break;
+            }
+        }
+
+        // drop the firmware replies, nobody reads them here
+        char discard[512];
+        while (read(port, discard, sizeof(discard)) > 0)
+            continue;
+
+        std::cout << "[INFO] trial " << std::setw(3) << trial + 1 << " | id " << std::setw(4) << id << " | "
+                  << (result.detected ? "detected" : "missed  ") << " | " << std::fixed << std::setprecision(1)
+                  << std::setw(7) << result.latencyMs << " ms | " << std::setw(3) << result.frames << " frames\n";
+        results.push_back(result);
+    }
+    close(port);
+
+    std::vector<double> latencies;
+    int wrongIds = 0;
+    for (auto &result : results) {
+        if (result.detected)
+            latencies.push_back(result.latencyMs);
+        wrongIds += result.wrongIds;
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    double recall = results.empty() ? 0 : static_cast<double>(latencies.size()) / results.size();
+    double meanMs = latencies.empty() ? 0 : std::accumulate(latencies.begin(), latencies.end(), 0.0) / latencies.size();
+    double msPerFrame = processedFrames ? processingMs / processedFrames : 0;
+
+    std::cout << std::fixed << std::setprecision(3)
+              << "[INFO] recall              : " << recall << " (" << latencies.size() << "/" << results.size() << ")\n"
+              << "[INFO] latency mean/p50/p95/max (ms): " << meanMs << " / " << percentile(latencies, 0.5) << " / "
+              << percentile(latencies, 0.95) << " / " << (latencies.empty() ? 0 : latencies.back()) << "\n"
+              << "[INFO] processing          : " << msPerFrame << " ms/frame\n"
+              << "[INFO] wrong ids reported  : " << wrongIds << "\n";
+
+    if (ls.reportPath.empty())
+        return true;
+
+    cv::FileStorage fs(ls.reportPath, cv::FileStorage::WRITE);
+    if (not fs.isOpened()) {
+        std::cout << "[ERROR] could not open specified file (" << ls.reportPath << ") " << std::endl;
+        return true;
+    }
+
+    fs << "Dictionary" << ls.dict
+       << "Color_Channel" << std::string(1, ls.targetClr)
+       << "Decoder" << std::string(ls.ledGrid ? "led" : "aruco")
+       << "Seed" << static_cast<int>(ls.seed)
+       << "Recall" << recall
+       << "Latency_Mean_ms" << meanMs
+       << "Latency_P50_ms" << percentile(latencies, 0.5)
+       << "Latency_P95_ms" << percentile(latencies, 0.95)
+       << "Latency_Max_ms" << (latencies.empty() ? 0 : latencies.back())
+       << "Processing_ms_per_frame" << msPerFrame
+       << "Wrong_Ids" << wrongIds
+       << "Trials"
+       << "[";
+
+    for (auto &result : results)
+        fs << "{:"
+           << "Id" << result.id
+           << "Detected" << (int)result.detected
+           << "Latency_ms" << result.latencyMs
+           << "Frames" << result.frames
+           << "}";
+    fs << "]";
+
+    std::cout << "[INFO] latency report saved to " << ls.reportPath << "\n";
+    return true;
+}
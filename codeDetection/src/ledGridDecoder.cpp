@@ -0,0 +1,338 @@
+#include "../include/ledGridDecoder.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <numeric>
+
+#include <opencv2/calib3d.hpp>
+#include <opencv2/imgproc.hpp>
+
+#define LATTICE_REFINE_ITERATIONS 2
+
+LedGridDecoder::LedGridDecoder(const std::vector<std::string> &dictNames, LedGridSettings settings)
+    : settings(settings), codes(dictNames) {}
+
+const std::vector<std::string> &LedGridDecoder::dictNames() const {
+    return this->codes.dictNames;
+}
+
+/**
+ * @brief centroids of the mask components small enough to be a single led
+ *
+ */
+void LedGridDecoder::findDots(const cv::Mat &mask, std::vector<cv::Point2f> &dots) const {
+    cv::Mat labels, stats, centroids;
+    int nLabels = cv::connectedComponentsWithStats(mask, labels, stats, centroids, 8, CV_32S);
+    double maxArea = settings.maxDotAreaRate * mask.total();
+
+    dots.clear();
+    for (int label = 1; label < nLabels; label++) {  // label 0 is the background
+        int area = stats.at<int>(label, cv::CC_STAT_AREA);
+        if (area >= settings.minDotArea and area <= maxArea)
+            dots.push_back(cv::Point2f(centroids.at<double>(label, 0), centroids.at<double>(label, 1)));
+    }
+}
+
+static cv::Rect2f dotBounds(const std::vector<cv::Point2f> &dots) {
+    float x0 = dots[0].x, y0 = dots[0].y, x1 = x0, y1 = y0;
+    for (auto &dot : dots) {
+        x0 = std::min(x0, dot.x);
+        y0 = std::min(y0, dot.y);
+        x1 = std::max(x1, dot.x);
+        y1 = std::max(y1, dot.y);
+    }
+    return cv::Rect2f(x0, y0, x1 - x0, y1 - y0);
+}
+
+/**
+ * @brief Dot indices bucketed on a uniform grid, so that neighbour searches only look at nearby cells
+ */
+struct DotGrid {
+    float cellSize;
+    float x0, y0;
+    int cols, rows;
+    std::vector<std::vector<int> > cells;
+
+    DotGrid(const std::vector<cv::Point2f> &dots, float cellSize) : cellSize(std::max(1.0f, cellSize)) {
+        cv::Rect2f bounds = dotBounds(dots);
+        x0 = bounds.x;
+        y0 = bounds.y;
+        cols = int(bounds.width / this->cellSize) + 1;
+        rows = int(bounds.height / this->cellSize) + 1;
+        cells.resize(size_t(cols) * rows);
+        for (int i = 0; i < dots.size(); i++) {
+            cv::Point cell = cellOf(dots[i]);
+            cells[cell.y * cols + cell.x].push_back(i);
+        }
+    }
+
+    cv::Point cellOf(const cv::Point2f &p) const {
+        return cv::Point(std::min(cols - 1, int((p.x - x0) / cellSize)),
+                         std::min(rows - 1, int((p.y - y0) / cellSize)));
+    }
+
+    /**
+     * @brief call visit(dot index) for every dot in the cells at exactly ring cells (chessboard distance) of center
+     *
+     */
+    template <typename Visit>
+    void visitRing(cv::Point center, int ring, Visit visit) const {
+        for (int y = std::max(0, center.y - ring); y <= std::min(rows - 1, center.y + ring); y++) {
+            bool fullRow = ring == 0 or y == center.y - ring or y == center.y + ring;
+            for (int x = center.x - ring; x <= center.x + ring; x += fullRow ? 1 : 2 * ring)
+                if (x >= 0 and x < cols)
+                    for (int j : cells[y * cols + x])
+                        visit(j);
+        }
+    }
+};
+
+/**
+ * @brief split the dots into markers - two dots belong to the same marker when they are at most linkRate lattice
+ *        steps apart (measured with the nearest neighbour distance of the closer packed one). findDots() already
+ *        dropped the components that cannot be a led, the rest is bucketed on grids sized to the dot spacing and to
+ *        the led pitch so that a noisy mask costs about linear time instead of comparing every pair.
+ *
+ */
+void LedGridDecoder::groupDots(const std::vector<cv::Point2f> &dots,
+                               std::vector<std::vector<cv::Point2f> > &groups) const {
+    int n = dots.size();
+    std::vector<double> nearest(n, std::numeric_limits<double>::max());
+
+    groups.clear();
+    if (n == 0)
+        return;
+
+    // exact nearest neighbours on a grid of about one dot per cell: rings of cells are searched until nothing
+    // closer can be left outside of them
+    cv::Rect2f bounds = dotBounds(dots);
+    DotGrid spread(dots, std::sqrt((bounds.width + 1) * (bounds.height + 1) / n));
+
+    for (int i = 0; i < n; i++) {
+        cv::Point cell = spread.cellOf(dots[i]);
+        int maxRing = std::max(spread.cols, spread.rows);
+        for (int ring = 0; ring <= maxRing; ring++) {
+            spread.visitRing(cell, ring, [&](int j) {
+                if (j != i)
+                    nearest[i] = std::min(nearest[i], cv::norm(dots[i] - dots[j]));
+            });
+            if (nearest[i] <= ring * spread.cellSize)
+                break;
+        }
+    }
+
+    std::vector<double> sorted = nearest;
+    std::nth_element(sorted.begin(), sorted.begin() + n / 2, sorted.end());
+    double pitch = n > 1 ? sorted[n / 2] : 1;
+
+    std::vector<int> parent(n);
+    std::iota(parent.begin(), parent.end(), 0);
+    auto root = [&parent](int i) {
+        while (parent[i] != i)
+            i = parent[i] = parent[parent[i]];
+        return i;
+    };
+
+    // cells of linkRate lattice steps: the links of a led are all in the neighbouring cells, only dots sparser than
+    // the median (stray dots, lone leds) have to look further
+    DotGrid links(dots, settings.linkRate * pitch);
+    for (int i = 0; i < n; i++) {
+        cv::Point cell = links.cellOf(dots[i]);
+        int maxRing = std::max(links.cols, links.rows);
+        double reach = settings.linkRate * nearest[i];
+        for (int ring = 0; ring <= maxRing and (ring - 1) * links.cellSize <= reach; ring++)
+            links.visitRing(cell, ring, [&](int j) {
+                if (j > i and cv::norm(dots[i] - dots[j]) <= settings.linkRate * std::min(nearest[i], nearest[j]))
+                    parent[root(i)] = root(j);
+            });
+    }
+
+    std::map<int, std::vector<cv::Point2f> > byRoot;
+    for (int i = 0; i < n; i++)
+        byRoot[root(i)].push_back(dots[i]);
+
+    for (auto &pair : byRoot)
+        groups.push_back(pair.second);
+}
+
+/**
+ * @brief fit the led lattice of one group of dots and read its code
+ *
+ * @param mask color mask the dots were taken from
+ * @param group dot centroids of a single marker
+ * @param corners marker corners (outer edge of the border), same order as cv::aruco::detectMarkers
+ * @param entry decoded marker
+ * @return true if the group decodes to a marker of any of the dictionaries
+ */
+bool LedGridDecoder::decodeGroup(const cv::Mat &mask, const std::vector<cv::Point2f> &group,
+                                 std::vector<cv::Point2f> &corners, CodeEntry &entry) const {
+    // every lit led of a marker is in its data area: a bigger group is a cluster of noise, dropped before the
+    // quadratic neighbour search and the homography
+    int n = group.size();
+    int maxSize = codes.gridSizes().back();
+    if (n < 4 or n > maxSize * maxSize)
+        return false;
+
+    // lattice pitch and orientation from the nearest neighbour of every dot (angles folded over 90 degrees)
+    std::vector<double> nearest(n, std::numeric_limits<double>::max());
+    std::vector<cv::Point2f> nearestVec(n);
+    for (int i = 0; i < n; i++)
+        for (int j = 0; j < n; j++) {
+            double d = cv::norm(group[i] - group[j]);
+            if (i != j and d < nearest[i]) {
+                nearest[i] = d;
+                nearestVec[i] = group[j] - group[i];
+            }
+        }
+
+    std::vector<double> sorted = nearest;
+    std::nth_element(sorted.begin(), sorted.begin() + n / 2, sorted.end());
+    double pitch = sorted[n / 2];
+
+    double c4 = 0, s4 = 0;
+    for (int i = 0; i < n; i++) {
+        if (nearest[i] > 1.3 * pitch)
+            continue;
+        double angle = std::atan2(nearestVec[i].y, nearestVec[i].x);
+        c4 += std::cos(4 * angle);
+        s4 += std::sin(4 * angle);
+    }
+    double theta = std::atan2(s4, c4) / 4;
+    cv::Point2f ex(std::cos(theta), std::sin(theta)), ey(-std::sin(theta), std::cos(theta));
+
+    // integer lattice coordinates of every dot, refined through the homography to absorb perspective
+    std::vector<cv::Point2f> lattice(n);
+    for (int i = 0; i < n; i++) {
+        cv::Point2f d = group[i] - group[0];
+        lattice[i] = cv::Point2f(std::round(d.dot(ex) / pitch), std::round(d.dot(ey) / pitch));
+    }
+
+    // a single row or column of leds does not define a homography
+    auto sameRow = [&](const cv::Point2f &p) { return p.y == lattice[0].y; };
+    auto sameCol = [&](const cv::Point2f &p) { return p.x == lattice[0].x; };
+    if (std::all_of(lattice.begin(), lattice.end(), sameRow) or std::all_of(lattice.begin(), lattice.end(), sameCol))
+        return false;
+
+    cv::Mat homography;
+    for (int iteration = 0; iteration <= LATTICE_REFINE_ITERATIONS; iteration++) {
+        homography = cv::findHomography(lattice, group, 0);
+        if (homography.empty() or iteration == LATTICE_REFINE_ITERATIONS)
+            break;
+
+        std::vector<cv::Point2f> projected;
+        cv::perspectiveTransform(group, projected, homography.inv());
+        for (int i = 0; i < n; i++)
+            lattice[i] = cv::Point2f(std::round(projected[i].x), std::round(projected[i].y));
+    }
+    if (homography.empty())
+        return false;
+
+    float iMin = lattice[0].x, iMax = lattice[0].x, jMin = lattice[0].y, jMax = lattice[0].y;
+    for (auto &point : lattice) {
+        iMin = std::min(iMin, point.x);
+        iMax = std::max(iMax, point.x);
+        jMin = std::min(jMin, point.y);
+        jMax = std::max(jMax, point.y);
+    }
+    int spanI = iMax - iMin + 1, spanJ = jMax - jMin + 1;
+
+    int half = std::max(1, int(std::round(settings.sampleRate * pitch)));
+    cv::Rect frame(0, 0, mask.cols, mask.rows);
+    auto lit = [&](const cv::Point2f &p) {
+        cv::Rect window = cv::Rect(cvRound(p.x) - half, cvRound(p.y) - half, 2 * half + 1, 2 * half + 1) & frame;
+        return window.area() > 0 and 2 * cv::countNonZero(mask(window)) > window.area();
+    };
+
+    bool found = false;
+    for (int markerSize : codes.gridSizes()) {
+        if (spanI > markerSize or spanJ > markerSize)
+            continue;
+
+        int cells = markerSize + 2;
+        int maxBorderErrors = int(markerSize * markerSize * settings.maxErroneousBitsInBorderRate);
+
+        // leds on the edge of the data area may be off, so every placement of the lit span is tried
+        for (int offsetJ = 0; offsetJ <= markerSize - spanJ; offsetJ++)
+            for (int offsetI = 0; offsetI <= markerSize - spanI; offsetI++) {
+                float i0 = iMin - offsetI - 1, j0 = jMin - offsetJ - 1;  // first border module
+
+                std::vector<cv::Point2f> modules, samples;
+                for (int y = 0; y < cells; y++)
+                    for (int x = 0; x < cells; x++)
+                        modules.push_back(cv::Point2f(i0 + x, j0 + y));
+                cv::perspectiveTransform(modules, samples, homography);
+
+                uint64_t code = 0;
+                int borderErrors = 0;
+                for (int y = 0; y < cells; y++)
+                    for (int x = 0; x < cells; x++) {
+                        bool bit = lit(samples[y * cells + x]);
+                        if (y == 0 or x == 0 or y == cells - 1 or x == cells - 1)
+                            borderErrors += bit;
+                        else
+                            code = (code << 1) | bit;
+                    }
+
+                CodeEntry candidate;
+                if (borderErrors > maxBorderErrors or not codes.lookup(markerSize, code, candidate))
+                    continue;
+                if (found and candidate.distance >= entry.distance)
+                    continue;
+
+                found = true;
+                entry = candidate;
+
+                std::vector<cv::Point2f> outline{{i0 - 0.5f, j0 - 0.5f},
+                                                 {i0 + cells - 0.5f, j0 - 0.5f},
+                                                 {i0 + cells - 0.5f, j0 + cells - 0.5f},
+                                                 {i0 - 0.5f, j0 + cells - 0.5f}};
+                cv::perspectiveTransform(outline, corners, homography);
+            }
+    }
+
+    if (found)
+        std::rotate(corners.begin(), corners.begin() + 4 - entry.rotation, corners.end());
+
+    return found;
+}
+
+/**
+ * @brief detect the markers shown on led matrices
+ *
+ * @param mask binary color mask without morphology (processLedFrame())
+ * @param corners marker corners, same order as cv::aruco::detectMarkers
+ * @param ids marker ids
+ * @param dictSlots index in dictNames() of the dictionary each marker belongs to
+ */
+void LedGridDecoder::detect(const cv::Mat &mask, std::vector<std::vector<cv::Point2f> > &corners,
+                            std::vector<int> &ids, std::vector<int> &dictSlots) const {
+    std::vector<cv::Point2f> dots;
+    std::vector<std::vector<cv::Point2f> > groups;
+
+    corners.clear();
+    ids.clear();
+    dictSlots.clear();
+
+    findDots(mask, dots);
+    groupDots(dots, groups);
+
+    for (auto &group : groups) {
+        std::vector<cv::Point2f> markerCorners;
+        CodeEntry entry;
+        if (not decodeGroup(mask, group, markerCorners, entry))
+            continue;
+
+        bool seen = false;
+        for (int i = 0; i < ids.size(); i++)
+            if (ids[i] == entry.id and dictSlots[i] == entry.dictSlot)
+                seen = true;
+        if (seen)
+            continue;
+
+        corners.push_back(markerCorners);
+        ids.push_back(entry.id);
+        dictSlots.push_back(entry.dictSlot);
+    }
+}
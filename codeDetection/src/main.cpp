@@ -1,5 +1,9 @@
 #include <map>
+#include <memory>
+#include <sstream>
 #include <array>
+#include <chrono>
+#include <cstring>
 #include <string>
 #include <vector>
 #include <iomanip>
@@ -8,59 +12,25 @@
 #include <opencv2/aruco.hpp>
 #include <opencv2/opencv.hpp>
 
+#include "../include/arucoPipeline.hpp"
+#include "../include/arucoSettings.hpp"
 #include "../include/cameraSettings.hpp"
-// #include "../include/arucoSettings.hpp"
+#include "../include/batchProcessor.hpp"
+#include "../include/controlChannel.hpp"
+#include "../include/detectionLog.hpp"
+#include "../include/firmwareEmulator.hpp"
+#include "../include/frameRecording.hpp"
+#include "../include/latencyHarness.hpp"
+#include "../include/paramTuner.hpp"
+#include "../include/preprocessBenchmark.hpp"
+#include "../include/resultRing.hpp"
+#include "../include/ringLatency.hpp"
+#include "../include/motionGate.hpp"
+#include "../include/sceneGenerator.hpp"
+#include "../include/stripePool.hpp"
 
 // ####################################################################################################################
 
-#define DELTA 12
-
-auto ARUCO_PARAMS = cv::aruco::DetectorParameters::create();
-
-const std::map<std::string, int> supportedArucoTypes{
-    {"4_50", cv::aruco::DICT_4X4_50},
-    {"4_100", cv::aruco::DICT_4X4_100},
-    {"4_250", cv::aruco::DICT_4X4_250},
-    {"4_1000", cv::aruco::DICT_4X4_1000},
-    {"5_50", cv::aruco::DICT_5X5_50},
-    {"5_100", cv::aruco::DICT_5X5_100},
-    {"5_250", cv::aruco::DICT_5X5_250},
-    {"5_1000", cv::aruco::DICT_5X5_1000},
-    {"6_50", cv::aruco::DICT_6X6_50},
-    {"6_100", cv::aruco::DICT_6X6_100},
-    {"6_250", cv::aruco::DICT_6X6_250},
-    {"6_1000", cv::aruco::DICT_6X6_1000},
-    {"original", cv::aruco::DICT_ARUCO_ORIGINAL},
-};
-
-// ####################################################################################################################
-
-int dictInput(int currDict) {
-    std::string userInput;
-    while (not supportedArucoTypes.contains(userInput)) {
-        std::cout << "Input a aruco dictionary type do detect (suported types: -h / --help): ";
-        std::cin >> std::setw(10) >> userInput;
-
-        // putback of a newline is done to avoid infinite loops and EOF breaking the code
-        if (std::cin.eof()) {
-            std::cin.clear();
-            std::cin.putback('\n');
-            std::cout << "\u001b[2K\r";
-        }
-
-        if ((userInput == "-h" or userInput == "-help") and std::cin.peek() == '\n' and std::cin.good()) {
-            std::cout << "Supported dict values (usage: -d=<value>)\n";
-            for (auto pair : supportedArucoTypes)
-                std::cout << " -- \"" << pair.first << "\"\n";
-            continue;
-        }
-
-        std::cin.clear();
-        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-    }
-    return supportedArucoTypes.at(userInput);
-}
-
 char colorInput(char currClr) {
     char userInput = '0';
     const std::string allowedColors = "rgbw";
@@ -82,90 +52,158 @@ char colorInput(char currClr) {
     return userInput;
 }
 
-void maskFrame(const cv::Mat &inFrame, cv::Mat &outFrame, char targetClr, int delta = DELTA) {
-    cv::Mat bgr[3];
-    cv::split(inFrame, bgr);
+// ####################################################################################################################
 
-    std::map<char, cv::Mat> clrChannels{{'r', bgr[2]}, {'g', bgr[1]}, {'b', bgr[0]}};
+/**
+ * @brief Optional parts of the frame loop, all off by default
+ */
+struct RecLoopOptions {
+    std::string controlSocket;
+    char targetClr = 'w';  // starting color channel when there is a control socket (stdin is not asked then)
+    float ledPitch = 0;    // synthetic frames: marker side follows the dictionary, (markerSize + 2) * ledPitch
+    std::string dictList;
+    bool ledGrid = false;
+    MotionGate *motionGate = nullptr;
+    RecordingWriter *recorder = nullptr;  // raw frames, queued before anything is drawn on them
+    DetectionLog *detectionLog = nullptr;
+    ResultRingWriter *resultRing = nullptr;
+    std::string sourceName = "live";
+    int preprocessThreads = 0;  // > 0: mask/denoise/morphology over stripes on this many threads
+    const ArucoSettings *profile = nullptr;  // tuned detector profile, defaults when not set
+};
 
-    cv::Mat targetCh = clrChannels[targetClr];
-    cv::Mat color1, color2;
+/**
+ * @brief Owners of the outputs RecLoopOptions points to
+ */
+struct LoopOutputs {
+    std::unique_ptr<RecordingWriter> recorder;
+    std::unique_ptr<DetectionLog> detectionLog;
+    std::unique_ptr<ResultRingWriter> resultRing;
+};
 
-    for (auto pair : clrChannels) {
-        if (pair.first == targetClr)
-            continue;
-        if (color1.empty())
-            color1 = clrChannels[pair.first];
-        else
-            color2 = clrChannels[pair.first];
+/**
+ * @brief hand the detections of a frame to the shared memory consumers, one record per marker (or a single
+ *        markerId -1 record when there are none)
+ *
+ */
+static void publishDetections(ResultRingWriter &ring, uint64_t frameId, int64_t timestampNs,
+                              const DetectionConfig &config, const std::vector<MarkerDetection> &detections) {
+    ResultRecord record{};
+    record.frameId = frameId;
+    record.timestampNs = timestampNs;
+    record.colorChannel = config.targetClr;
+    record.markerCount = detections.size();
+    record.markerId = -1;
+
+    if (detections.empty()) {
+        ring.publish(record);
+        return;
     }
 
-    cv::Mat colorMask = (targetCh > (color1 + delta)) & (targetCh > (color2 + delta));
-    cv::Mat falsePositives = (color1 < 255 - delta) & (color2 < 255 - delta);
-
-    outFrame = cv::Mat::zeros(targetCh.rows, targetCh.cols, targetCh.type());
-    outFrame = (255 * (colorMask & falsePositives));
-}
-
-void processFrame(const cv::Mat &inFrame, cv::Mat &outFrame, char targetClr, cv::Size kSize = cv::Size(10, 10)) {
-    // normal color for the codes -- handled by default by openCV
-    if (targetClr == 'w')
-        return cv::cvtColor(inFrame, outFrame, cv::COLOR_BGR2GRAY);
-
-    // run a bilateralFilter to blur the original image - helps reducing noise for future masking
-    cv::bilateralFilter(inFrame, outFrame, 5, 75, 90);  //! needs revision
-
-    // threshold image relative to the selected color channel
-    maskFrame(outFrame, outFrame, targetClr);
+    for (int i = 0; i < detections.size(); i++) {
+        const MarkerDetection &detection = detections[i];
+        std::string dictName = detection.dictName.empty() ? config.dictName : detection.dictName;
 
-    // kernels for dilation and erosion operations
-    cv::Mat dilKernel = cv::getStructuringElement(cv::MORPH_ELLIPSE, kSize);
-    cv::Mat erKernel = cv::getStructuringElement(cv::MORPH_RECT, kSize);
+        record.markerId = detection.id;
+        record.markerIndex = i;
+        record.reused = detection.reused;
+        std::memset(record.dictName, 0, sizeof(record.dictName));
+        dictName.copy(record.dictName, sizeof(record.dictName) - 1);
 
-    //image dilation and erosion for eliminating noise created by the color mask
-    cv::dilate(outFrame, outFrame, dilKernel);
-    cv::erode(outFrame, outFrame, erKernel);
-}
-
-void detectMarkers(CameraSettings cs, cv::Mat &original, cv::Mat &masked, cv::Ptr<cv::aruco::Dictionary> dict, float mLen) {
-    std::vector<int> ids;
-    std::vector<cv::Vec3d> rvecs, tvecs;
-    std::vector<std::vector<cv::Point2f> > corners, rejected;
-
-    cv::aruco::detectMarkers(masked, dict, corners, ids, ARUCO_PARAMS, rejected, cs.cameraMatrix, cs.distortionCoeffs);
-
-    if (not corners.empty()) {
-        cv::aruco::drawDetectedMarkers(original, corners, ids);
-        cv::aruco::estimatePoseSingleMarkers(corners, mLen, cs.cameraMatrix, cs.distortionCoeffs, rvecs, tvecs);
-
-        for (int i = 0; i < rvecs.size(); i++) {
-            auto rvec = rvecs[i];
-            auto tvec = tvecs[i];
-            cv::aruco::drawAxis(original, cs.cameraMatrix, cs.distortionCoeffs, rvec, tvec, mLen / 3);
+        for (int c = 0; c < 4; c++) {
+            record.corners[2 * c] = detection.corners[c].x;
+            record.corners[2 * c + 1] = detection.corners[c].y;
+        }
+        for (int k = 0; k < 3; k++) {
+            record.rvec[k] = detection.rvec[k];
+            record.tvec[k] = detection.tvec[k];
         }
+
+        ring.publish(record);
     }
 }
 
-// ####################################################################################################################
+static int64_t captureTimestamp() {
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+}
 
-void arucoRecLoop(CameraSettings cs, cv::VideoCapture &vidCap, std::string dict, float mLen) {
+void arucoRecLoop(CameraSettings cs, cv::VideoCapture &vidCap, std::string dict, float mLen,
+                  const RecLoopOptions &options = RecLoopOptions()) {
+    bool quit = false;
+    long frameIndex = 0;
     cv::Mat frame, maskedFrame;
+    std::vector<MarkerDetection> detections;
+
+    DetectionConfig config;
+    char targetClr = options.controlSocket.empty() ? colorInput(config.targetClr) : options.targetClr;
+    makeDetectionConfig(dict, options.dictList, options.ledGrid, targetClr, config);
+    if (options.profile)
+        options.profile->apply(config);
+
+    // with stripes the preprocessing parallelism is the pool's, opencv's own threads inside every stripe worker
+    // would only oversubscribe the cores (same as the --pb benchmark), the default is restored on exit
+    int cvThreads = cv::getNumThreads();
+    if (options.preprocessThreads > 0) {
+        config.stripePool = cv::makePtr<StripePool>(options.preprocessThreads);
+        cv::setNumThreads(1);
+    }
+
+    if (config.multiDict)
+        std::cout << "[INFO] Detecting " << config.multiDict->dictNames.size() << " dictionaries at once ("
+                  << config.multiDict->indexSize() << " indexed codes)\n";
 
-    char targetColorCh = colorInput(targetColorCh);
-    int dictIndex = supportedArucoTypes.at(dict);
-    auto arucoDict = cv::aruco::getPredefinedDictionary(dictIndex);
-    std::cout << "Grabbing frames ... " << std::endl;
+    // dictionary/color/param changes are typed while frames keep flowing and are picked up between frames
+    ControlChannel control(config, options.controlSocket);
+    if (not control.OK) {
+        std::cout << "[FATAL] could not open the control socket " << options.controlSocket << "\n";
+        cv::setNumThreads(cvThreads);
+        return;
+    }
+    std::cout << "Grabbing frames ... (type help for live commands)" << std::endl;
+
+    MotionGate *motionGate = options.motionGate;
+
+    while (not quit and not control.quitRequested()) {
+        if (control.poll(config)) {
+            std::cout << "[INFO] now detecting dict " << config.dictName << " on color channel " << config.targetClr
+                      << std::endl;
+            // a dictionary list has no single marker size, the last one is kept for every pose
+            if (options.ledPitch > 0 and config.multiDict)
+                std::cout << "[INFO] several dictionaries, poses keep assuming " << mLen << " m markers\n";
+            else if (options.ledPitch > 0)
+                mLen = (config.dict->markerSize + 2) * options.ledPitch;
+            if (motionGate)
+                motionGate->invalidate();
+        }
 
-    while (true) {
         vidCap.read(frame);
+        int64_t timestampNs = captureTimestamp();
 
         if (frame.empty()) {
             std::cout << "[FATAL] blank frame grabbed.\n";
             break;
         }
 
-        processFrame(frame, maskedFrame, targetColorCh);
-        detectMarkers(cs, frame, maskedFrame, arucoDict, mLen);
+        if (options.recorder)
+            options.recorder->write(frame, timestampNs);
+
+        if (motionGate and not motionGate->needsProcessing(frame)) {
+            // static scene: keep the last ids and poses, only redraw them on the new frame
+            for (auto &detection : detections)
+                detection.reused = true;
+            drawMarkers(cs, frame, detections, mLen);
+        } else {
+            detectFrame(cs, config, frame, maskedFrame, mLen, detections);
+        }
+
+        if (options.resultRing)
+            publishDetections(*options.resultRing, frameIndex, timestampNs, config, detections);
+
+        if (options.detectionLog)
+            options.detectionLog->write(
+                DetectionLog::format(options.sourceName, frameIndex, timestampNs, config.dictName, detections));
+        frameIndex++;
 
         cv::imshow("Live", frame);
         cv::imshow("Color Mask", maskedFrame);
@@ -174,18 +212,72 @@ void arucoRecLoop(CameraSettings cs, cv::VideoCapture &vidCap, std::string dict,
         int key = cv::waitKey(1) & 0xff;
         switch (key) {
             case 'd':
-                dictIndex = dictInput(dictIndex);
-                arucoDict = cv::aruco::getPredefinedDictionary(dictIndex);
+                std::cout << "[INFO] type \"dict <type>\" in the terminal to switch dictionaries (help for types)\n";
                 break;
 
             case 'c':
-                targetColorCh = colorInput(targetColorCh);
+                std::cout << "[INFO] type \"color <r/g/b/w>\" in the terminal to switch color channels\n";
                 break;
 
             case 'q':
-                return;
+                quit = true;
+                break;
         }
     }
+
+    cv::setNumThreads(cvThreads);
+
+    if (motionGate)
+        std::cout << "[INFO] Motion gate: " << motionGate->stats() << std::endl;
+    if (options.recorder) {
+        options.recorder->close();  // waits for the writer thread to drain its queue
+        std::cout << "[INFO] Recorded " << options.recorder->frameCount() << " frames\n";
+    }
+    if (options.detectionLog)
+        options.detectionLog->close();
+}
+
+/**
+ * @brief open the --record, --detections and --ring outputs of the frame loop
+ *
+ * @param source name written in the detection records and in the recording metadata
+ * @return false if an output was asked for but could not be created
+ */
+static bool openLoopOutputs(const cv::CommandLineParser &parser, const CameraSettings &cs, float mLen,
+                            const std::string &source, LoopOutputs &outputs, RecLoopOptions &options) {
+    options.sourceName = source;
+
+    if (parser.has("record")) {
+        RecordingSettings rs;
+        rs.compress = not parser.has("rawRecording");
+
+        RecordingMetadata metadata{cs.cameraMatrix, cs.distortionCoeffs, mLen, source};
+        outputs.recorder = std::make_unique<RecordingWriter>(parser.get<std::string>("record"), metadata, rs);
+        if (not outputs.recorder->OK)
+            return false;
+        options.recorder = outputs.recorder.get();
+    }
+
+    if (parser.has("detections")) {
+        outputs.detectionLog = std::make_unique<DetectionLog>(parser.get<std::string>("detections"));
+        if (not outputs.detectionLog->OK)
+            return false;
+        options.detectionLog = outputs.detectionLog.get();
+    }
+
+    if (parser.has("ring")) {
+        std::string name = parser.get<std::string>("ring");
+        if (name.empty() or name == "true")  // --ring without a name
+            name = RESULT_RING_DEFAULT_NAME;
+
+        outputs.resultRing = std::make_unique<ResultRingWriter>(name);
+        if (not outputs.resultRing->OK)
+            return false;
+        options.resultRing = outputs.resultRing.get();
+        std::cout << "[INFO] Publishing detections to shared memory " << name << " (ringReader " << name << ")\n";
+    }
+
+    return true;
 }
 
 int main(int argc, char **argv) {
@@ -196,7 +288,32 @@ int main(int argc, char **argv) {
         "{markerSquareSize ms             |      | aruco marker side lenght (in meters)                               }"
         "{calibrationSquareSize cs        | 0.02 | side lenght (in meters) of the chessboard squares (for calibration)}"
         "{calibrationVerticalCorners vc   |  7   | number of inner corners - vertical (chessboard for calibration)    }"
-        "{calibrationHorizontalCorners hc |  12  | number of inner corners - horizontal (chessboard for calibration)  }";
+        "{calibrationHorizontalCorners hc |  12  | number of inner corners - horizontal (chessboard for calibration)  }"
+        "{synthetic s                     |      | grab frames from an emulated led matrix instead of the webcam      }"
+        "{latencyReport lr                |      | run the synthetic latency/recall harness, save report to this file }"
+        "{trials t                        |  20  | number of code changes timed by the latency harness                }"
+        "{control                         |      | unix socket path for live commands (stdin is always listened to)   }"
+        "{dicts                           |      | dictionaries detected at once, comma separated (ex: 4_50,6_50)     }"
+        "{ledGrid led                     |      | decode the led lattice directly (no morphology, no adaptive thresh)}"
+        "{motionGate mg                   |      | skip the pipeline on static frames and reuse the last detections   }"
+        "{motionThreshold                 |  6   | mean tile difference (0-255) that counts as motion                 }"
+        "{refreshInterval                 |  30  | run the full pipeline at least once every this many frames         }"
+        "{record rec                      |      | save the captured frames (with timestamps) to this .carec file     }"
+        "{rawRecording                    |      | store recorded frames uncompressed instead of as lossless png      }"
+        "{detections det                  |      | write every detection to this csv file (live and batch modes)      }"
+        "{batch                           |      | process recordings/image directories offline (comma separated)     }"
+        "{threads j                       |  0   | batch workers / benchmark max threads (0 = one per core)           }"
+        "{color                           |  w   | color channel masked in batch mode or with --control (r/g/b/w)     }"
+        "{preprocessThreads pt            |  0   | run the color mask and morphology over stripes on this many threads}"
+        "{preprocessBench pb              |      | striped preprocessing benchmark on 1..-j threads, report to file   }"
+        "{ring                            |      | publish detections to this POSIX shared memory ring (/name)        }"
+        "{ringLatency                     |      | run the shared memory ring latency test, save report to this file  }"
+        "{profile                         |      | detector profile (default: ../resources/aruco_profile.yml if any)  }"
+        "{tune                            |      | tune the detector on synthetic frames, or on this .carec recording }"
+        "{labels                          |      | detections csv with the expected ids of the tuning recording       }"
+        "{minRecall                       |  0   | tuner picks the fastest profile with this recall (0 = best recall) }"
+        "{tuneReport                      |      | save every tuned parameter set (and the Pareto front) to this file }"
+        "{calibration                     |      | calibration file for image directories (default: resources folder)}";
 
     cv::CommandLineParser parser(argc, argv, keys);
     parser.about("opencv video stream aruco detection");
@@ -206,6 +323,153 @@ int main(int argc, char **argv) {
         return 0;
     }
 
+    std::string profilePath = parser.has("profile") ? parser.get<std::string>("profile") : ARUCO_PROFILE_PATH;
+
+    if (parser.has("tune")) {
+        TunerSettings ts;
+        ts.recording = parser.get<std::string>("tune") == "true" ? "" : parser.get<std::string>("tune");
+        ts.labelsPath = parser.get<std::string>("labels");
+        ts.dict = parser.get<std::string>("dict");
+        ts.targetClr = parser.get<std::string>("color")[0];
+        if (ts.targetClr == 'w' and ts.recording.empty())  // white skips the mask and morphology, nothing to tune
+            ts.targetClr = 'r';
+        ts.markerLength = parser.has("markerSquareSize") ? std::abs(parser.get<float>("markerSquareSize")) : 0;
+        ts.minRecall = parser.get<double>("minRecall");
+        ts.profilePath = profilePath;
+        ts.reportPath = parser.get<std::string>("tuneReport");
+
+        if (std::string("rgbw").find(ts.targetClr) == std::string::npos) {
+            std::cout << "[FATAL] color channel must be one of r/g/b/w\n";
+            return -1;
+        }
+
+        if (not ts.recording.empty() and ts.labelsPath.empty()) {
+            std::cout << "[FATAL] tuning on a recording needs its labels (--labels=detections.csv)\n";
+            return -1;
+        }
+
+        return runParamTuner(ts) ? 0 : -1;
+    }
+
+    // tuned detector parameters, mask delta and kernel size - the defaults are kept when there is no profile
+    ArucoSettings profile(profilePath);
+    if (not profile.OK and parser.has("profile")) {
+        std::cout << "[FATAL] could not load the detector profile " << profilePath << "\n";
+        return -1;
+    }
+
+    MotionGate motionGate;
+    motionGate.settings.tileThreshold = parser.get<double>("motionThreshold");
+    motionGate.settings.refreshInterval = parser.get<int>("refreshInterval");
+
+    RecLoopOptions options;
+    options.controlSocket = parser.get<std::string>("control");
+    options.targetClr = parser.get<std::string>("color")[0];
+    if (not options.controlSocket.empty() and std::string("rgbw").find(options.targetClr) == std::string::npos) {
+        std::cout << "[FATAL] color channel must be one of r/g/b/w\n";
+        return -1;
+    }
+    options.dictList = parser.get<std::string>("dicts");
+    std::vector<std::string> listedDicts;
+    if (parser.has("dicts") and not MultiDictDetector::parseDictList(options.dictList, listedDicts)) {
+        std::cout << "[FATAL] --dicts must be a comma separated list of supported types (ex: 4_50,5_50,original)\n";
+        return -1;
+    }
+    options.ledGrid = parser.has("ledGrid");
+    options.motionGate = parser.has("motionGate") ? &motionGate : nullptr;
+    options.preprocessThreads = parser.get<int>("preprocessThreads");
+    options.profile = profile.OK ? &profile : nullptr;
+
+    LoopOutputs outputs;
+
+    if (parser.has("batch")) {
+        BatchSettings bs;
+        std::stringstream inputs(parser.get<std::string>("batch"));
+        for (std::string input; std::getline(inputs, input, ',');)
+            bs.inputs.push_back(input);
+
+        bs.outputPath = parser.get<std::string>("detections");
+        bs.threads = parser.get<int>("threads");
+        bs.dict = parser.get<std::string>("dict");
+        bs.dictList = options.dictList;
+        bs.ledGrid = options.ledGrid;
+        bs.targetClr = parser.get<std::string>("color")[0];
+        bs.markerLength = parser.has("markerSquareSize") ? std::abs(parser.get<float>("markerSquareSize")) : 0;
+        bs.profile = options.profile;
+        bs.calibrationPath = parser.has("calibration") ? parser.get<std::string>("calibration")
+                                                       : "../resources/calib_results.json";
+
+        if (bs.outputPath.empty() or bs.inputs.empty()) {
+            std::cout << "[FATAL] batch mode needs inputs and an output file (--batch=a.carec,dir --det=out.csv)\n";
+            return -1;
+        }
+
+        if (!supportedArucoTypes.contains(bs.dict) or std::string("rgbw").find(bs.targetClr) == std::string::npos) {
+            std::cout << "[FATAL] unsupported dictionary or color channel\n";
+            return -1;
+        }
+
+        return runBatch(bs) ? 0 : -1;
+    }
+
+    if (parser.has("latencyReport")) {
+        LatencySettings ls;
+        ls.dict = parser.get<std::string>("dict");
+        ls.trials = parser.get<int>("trials");
+        ls.reportPath = parser.get<std::string>("latencyReport");
+        ls.ledGrid = parser.has("ledGrid");
+        ls.profile = options.profile;
+
+        return runLatencyHarness(ls, SceneSettings()) ? 0 : -1;
+    }
+
+    if (parser.has("ringLatency")) {
+        RingLatencySettings rls;
+        rls.reportPath = parser.get<std::string>("ringLatency");
+        if (rls.reportPath == "true")  // --ringLatency without a report file
+            rls.reportPath.clear();
+
+        return runRingLatencyTest(rls) ? 0 : -1;
+    }
+
+    if (parser.has("preprocessBench")) {
+        PreprocessBenchSettings pbs;
+        pbs.maxThreads = parser.get<int>("threads");
+        // white is only a gray conversion, the whole mask/denoise/morphology chain runs for the other channels
+        pbs.targetClr = parser.get<std::string>("color")[0] == 'w' ? 'r' : parser.get<std::string>("color")[0];
+        pbs.reportPath = parser.get<std::string>("preprocessBench");
+
+        return runPreprocessBenchmark(pbs) ? 0 : -1;
+    }
+
+    if (parser.has("synthetic")) {
+        if (!supportedArucoTypes.contains(parser.get<std::string>("dict"))) {
+            std::cout << "[FATAL] aruco tag of type {dict" << parser.get<std::string>("dict") << "} is not supported\n";
+            return -1;
+        }
+
+        FirmwareEmulator emulator;
+        if (not emulator.OK)
+            return -1;
+
+        std::cout << "[INFO] Firmware emulator serial port: " << emulator.portName()
+                  << " (python3 colAruco.py -p " << emulator.portName() << ")\n";
+
+        SyntheticCapture vidCap(emulator, SceneSettings());
+        CameraSettings cs(vidCap.generator.cameraMatrix(), vidCap.generator.distortionCoeffs());
+
+        // marker side on the matrix is given by the led pitch, --ms is not needed
+        int markerSize = cv::aruco::getPredefinedDictionary(supportedArucoTypes.at(parser.get<std::string>("dict")))->markerSize;
+        float mLen = (markerSize + 2) * vidCap.generator.settings.ledPitch;
+        options.ledPitch = vidCap.generator.settings.ledPitch;
+
+        if (not openLoopOutputs(parser, cs, mLen, "synthetic", outputs, options))
+            return -1;
+
+        arucoRecLoop(cs, vidCap, parser.get<std::string>("dict"), mLen, options);
+        return 0;
+    }
+
     if (not parser.has("markerSquareSize")) {
         parser.printMessage();
         return 0;
@@ -236,7 +500,11 @@ int main(int argc, char **argv) {
     cv::VideoCapture vidCap;
     vidCap.open(cs.cameraIndex);
 
-    arucoRecLoop(cs, vidCap, parser.get<std::string>("dict"), std::abs(parser.get<float>("markerSquareSize")));
+    float mLen = std::abs(parser.get<float>("markerSquareSize"));
+    if (not openLoopOutputs(parser, cs, mLen, "camera" + std::to_string(cs.cameraIndex), outputs, options))
+        return -1;
+
+    arucoRecLoop(cs, vidCap, parser.get<std::string>("dict"), mLen, options);
 
     return 0;
 }
\ No newline at end of file
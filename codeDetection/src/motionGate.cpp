@@ -0,0 +1,74 @@
+#include "../include/motionGate.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#include <opencv2/imgproc.hpp>
+
+MotionGate::MotionGate(MotionGateSettings settings) : settings(settings) {}
+
+/**
+ * @brief compare the frame with the last processed one
+ *
+ * @param frame BGR or grayscale capture
+ * @return true if the frame has to go through the pipeline (it then becomes the new reference)
+ */
+bool MotionGate::needsProcessing(const cv::Mat &frame) {
+    cv::Mat gray, small;
+    if (frame.channels() == 3)
+        cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+    else
+        gray = frame;
+
+    int scale = std::max(1, settings.downscale);
+    cv::resize(gray, small, cv::Size(std::max(1, gray.cols / scale), std::max(1, gray.rows / scale)), 0, 0,
+               cv::INTER_AREA);
+
+    bool changed = reference.empty() or reference.size() != small.size();
+
+    if (not changed) {
+        cv::Mat diff, tiles;
+        cv::absdiff(small, reference, diff);
+
+        // area resize gives the mean difference of every tile
+        int tile = std::max(1, settings.tileSize);
+        cv::resize(diff, tiles, cv::Size(std::max(1, diff.cols / tile), std::max(1, diff.rows / tile)), 0, 0,
+                   cv::INTER_AREA);
+
+        changed = cv::countNonZero(tiles > settings.tileThreshold) > settings.maxChangedTiles;
+    }
+
+    bool refresh = not changed and framesSinceRefresh + 1 >= settings.refreshInterval;
+
+    if (not changed and not refresh) {
+        framesSinceRefresh++;
+        reusedFrames++;
+        return false;
+    }
+
+    if (refresh)
+        forcedRefreshes++;
+
+    reference = small;
+    framesSinceRefresh = 0;
+    processedFrames++;
+    return true;
+}
+
+/**
+ * @brief make the next frame go through the pipeline (ex: after the detection settings changed)
+ *
+ */
+void MotionGate::invalidate() {
+    reference.release();
+}
+
+std::string MotionGate::stats() const {
+    long total = processedFrames + reusedFrames;
+    std::stringstream ss;
+    ss << "processed " << processedFrames << " / reused " << reusedFrames << " frames (" << std::fixed
+       << std::setprecision(1) << (total ? 100.0 * reusedFrames / total : 0.0) << "% reused, " << forcedRefreshes
+       << " forced refreshes)";
+    return ss.str();
+}
@@ -0,0 +1,340 @@
+#include "../include/multiDictDetector.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+
+#include <opencv2/imgproc.hpp>
+
+#include "../include/arucoPipeline.hpp"
+
+static uint64_t packBits(const cv::Mat &bits) {
+    uint64_t code = 0;
+    for (int row = 0; row < bits.rows; row++)
+        for (int col = 0; col < bits.cols; col++)
+            code = (code << 1) | (bits.at<uchar>(row, col) ? 1 : 0);
+    return code;
+}
+
+/**
+ * @brief Build the code index of every dictionary in the list
+ *
+ * @param dictNames keys of supportedArucoTypes (must be valid, see parseDictList())
+ * @param maxCorrectionBits hamming distance accepted when decoding, capped by each dictionary own correction bits
+ */
+MultiDictDetector::MultiDictDetector(const std::vector<std::string> &dictNames, int maxCorrectionBits)
+    : dictNames(dictNames) {
+    for (int slot = 0; slot < dictNames.size(); slot++) {
+        auto dict = cv::aruco::getPredefinedDictionary(supportedArucoTypes.at(dictNames[slot]));
+        this->dicts.push_back(dict);
+
+        int flips = std::min(maxCorrectionBits, dict->maxCorrectionBits);
+
+        for (int id = 0; id < dict->bytesList.rows; id++) {
+            cv::Mat bits = cv::aruco::Dictionary::getBitsFromByteList(dict->bytesList.rowRange(id, id + 1),
+                                                                      dict->markerSize);
+
+            // same rotation convention as cv::aruco::Dictionary::getByteListFromBits (counter clockwise steps)
+            for (int rotation = 0; rotation < 4; rotation++) {
+                indexCode(dict->markerSize, packBits(bits), {slot, id, rotation, 0}, flips, 0);
+                cv::rotate(bits, bits, cv::ROTATE_90_COUNTERCLOCKWISE);
+            }
+        }
+    }
+}
+
+/**
+ * @brief register a code and all the patterns within remainingFlips bit flips of it. On collisions the closest
+ *        code wins, ties keep the dictionary listed first
+ *
+ */
+void MultiDictDetector::indexCode(int markerSize, uint64_t code, const CodeEntry &entry, int remainingFlips,
+                                  int firstBit) {
+    auto &index = this->codeIndex[markerSize];
+    auto found = index.find(code);
+    if (found == index.end() or found->second.distance > entry.distance)
+        index[code] = entry;
+
+    if (remainingFlips == 0)
+        return;
+
+    for (int bit = firstBit; bit < markerSize * markerSize; bit++) {
+        CodeEntry flipped = entry;
+        flipped.distance++;
+        indexCode(markerSize, code ^ (uint64_t(1) << bit), flipped, remainingFlips - 1, bit + 1);
+    }
+}
+
+/**
+ * @brief decode a markerSize x markerSize bit pattern (row major, first bit on the most significant position)
+ *
+ */
+bool MultiDictDetector::lookup(int markerSize, uint64_t code, CodeEntry &entry) const {
+    auto index = this->codeIndex.find(markerSize);
+    if (index == this->codeIndex.end())
+        return false;
+
+    auto found = index->second.find(code);
+    if (found == index->second.end())
+        return false;
+
+    entry = found->second;
+    return true;
+}
+
+std::vector<int> MultiDictDetector::gridSizes() const {
+    std::vector<int> sizes;
+    for (auto &pair : this->codeIndex)
+        sizes.push_back(pair.first);
+    return sizes;
+}
+
+size_t MultiDictDetector::indexSize() const {
+    size_t size = 0;
+    for (auto &pair : this->codeIndex)
+        size += pair.second.size();
+    return size;
+}
+
+/**
+ * @brief corner refinement methods detect() can apply - contour and apriltag refinement need the candidate contours
+ *        and the apriltag quad detector of cv::aruco, which the shared candidate stage does not keep
+ *
+ */
+bool MultiDictDetector::supportsCornerRefinement(int method) {
+    return method == cv::aruco::CORNER_REFINE_NONE or method == cv::aruco::CORNER_REFINE_SUBPIX;
+}
+
+/**
+ * @brief parse a comma separated list of dictionaries (ex: 4_50,5_50,6_50,original)
+ *
+ * @return false if the list is empty or any of the entries is not supported
+ */
+bool MultiDictDetector::parseDictList(const std::string &list, std::vector<std::string> &names) {
+    std::stringstream ss(list);
+    std::string name;
+
+    names.clear();
+    while (std::getline(ss, name, ',')) {
+        if (not supportedArucoTypes.contains(name))
+            return false;
+        names.push_back(name);
+    }
+    return not names.empty();
+}
+
+/**
+ * @brief quad candidates, same filtering as the cv::aruco detector (adaptive threshold scales, contour perimeter,
+ *        convexity, corner and border distances) but run only once for all dictionaries
+ *
+ */
+void MultiDictDetector::findCandidates(const cv::Mat &gray, const cv::Ptr<cv::aruco::DetectorParameters> &params,
+                                       std::vector<std::vector<cv::Point2f> > &candidates) const {
+    int maxSide = std::max(gray.cols, gray.rows);
+    double minPerimeter = params->minMarkerPerimeterRate * maxSide;
+    double maxPerimeter = params->maxMarkerPerimeterRate * maxSide;
+    int step = std::max(1, params->adaptiveThreshWinSizeStep);
+
+    std::vector<double> perimeters;
+    candidates.clear();
+
+    for (int winSize = params->adaptiveThreshWinSizeMin; winSize <= params->adaptiveThreshWinSizeMax; winSize += step) {
+        cv::Mat thresh;
+        cv::adaptiveThreshold(gray, thresh, 255, cv::ADAPTIVE_THRESH_MEAN_C, cv::THRESH_BINARY_INV,
+                              std::max(3, winSize | 1), params->adaptiveThreshConstant);
+
+        std::vector<std::vector<cv::Point> > contours;
+        cv::findContours(thresh, contours, cv::RETR_LIST, cv::CHAIN_APPROX_NONE);
+
+        for (auto &contour : contours) {
+            double perimeter = contour.size();
+            if (perimeter < minPerimeter or perimeter > maxPerimeter)
+                continue;
+
+            std::vector<cv::Point> approx;
+            cv::approxPolyDP(contour, approx, perimeter * params->polygonalApproxAccuracyRate, true);
+            if (approx.size() != 4 or not cv::isContourConvex(approx))
+                continue;
+
+            double minCornerDistance = params->minCornerDistanceRate * perimeter;
+            bool rejected = false;
+            for (int i = 0; i < 4; i++) {
+                cv::Point side = approx[i] - approx[(i + 1) % 4];
+                if (side.dot(side) < minCornerDistance * minCornerDistance)
+                    rejected = true;
+
+                int border = params->minDistanceToBorder;
+                if (approx[i].x < border or approx[i].y < border or approx[i].x > gray.cols - 1 - border or
+                    approx[i].y > gray.rows - 1 - border)
+                    rejected = true;
+            }
+            if (rejected)
+                continue;
+
+            std::vector<cv::Point2f> quad(approx.begin(), approx.end());
+
+            // clockwise corners, like cv::aruco
+            cv::Point2f d1 = quad[1] - quad[0], d2 = quad[2] - quad[0];
+            if (d1.x * d2.y - d1.y * d2.x < 0)
+                std::swap(quad[1], quad[3]);
+
+            // the same quad shows up on several threshold scales (and as the inner edge of its own border),
+            // keep the biggest one
+            double minMarkerDistance = params->minMarkerDistanceRate * perimeter;
+            bool duplicate = false;
+            for (int k = 0; k < candidates.size() and not duplicate; k++) {
+                for (int shift = 0; shift < 4; shift++) {
+                    double distSq = 0;
+                    for (int i = 0; i < 4; i++) {
+                        cv::Point2f d = quad[i] - candidates[k][(i + shift) % 4];
+                        distSq += d.dot(d) / 4;
+                    }
+
+                    if (distSq < minMarkerDistance * minMarkerDistance) {
+                        duplicate = true;
+                        if (perimeter > perimeters[k]) {
+                            candidates[k] = quad;
+                            perimeters[k] = perimeter;
+                        }
+                        break;
+                    }
+                }
+            }
+
+            if (not duplicate) {
+                candidates.push_back(quad);
+                perimeters.push_back(perimeter);
+            }
+        }
+    }
+}
+
+/**
+ * @brief read the inner bits of a candidate as a markerSize x markerSize grid (cv::aruco _extractBits equivalent)
+ *
+ * @param exactBorder accept no white cell at all in the border ring instead of maxErroneousBitsInBorderRate
+ * @return false if the border has too many white cells or the candidate is a flat patch
+ */
+bool MultiDictDetector::extractBits(const cv::Mat &gray, const std::vector<cv::Point2f> &candidate, int markerSize,
+                                    const cv::Ptr<cv::aruco::DetectorParameters> &params, bool exactBorder,
+                                    uint64_t &code) const {
+    int border = params->markerBorderBits;
+    int cellSize = params->perspectiveRemovePixelPerCell;
+    int cells = markerSize + 2 * border;
+    int side = cells * cellSize;
+    int margin = int(params->perspectiveRemoveIgnoredMarginPerCell * cellSize);
+
+    std::vector<cv::Point2f> square{{0, 0}, {float(side - 1), 0}, {float(side - 1), float(side - 1)}, {0, float(side - 1)}};
+    cv::Mat transform = cv::getPerspectiveTransform(candidate, square);
+
+    cv::Mat warped;
+    cv::warpPerspective(gray, warped, transform, cv::Size(side, side), cv::INTER_NEAREST);
+
+    cv::Scalar mean, stddev;
+    cv::Mat inner = warped(cv::Rect(cellSize / 2, cellSize / 2, side - cellSize, side - cellSize));
+    cv::meanStdDev(inner, mean, stddev);
+    if (stddev[0] < params->minOtsuStdDev)
+        return false;
+
+    cv::threshold(warped, warped, 125, 255, cv::THRESH_BINARY | cv::THRESH_OTSU);
+
+    int borderErrors = 0;
+    int maxBorderErrors = exactBorder ? 0 : int(markerSize * markerSize * params->maxErroneousBitsInBorderRate);
+    code = 0;
+
+    for (int y = 0; y < cells; y++) {
+        for (int x = 0; x < cells; x++) {
+            cv::Mat cell = warped(cv::Rect(x * cellSize + margin, y * cellSize + margin, cellSize - 2 * margin,
+                                           cellSize - 2 * margin));
+            bool bit = cv::countNonZero(cell) > cell.total() / 2;
+
+            bool isBorder = y < border or x < border or y >= cells - border or x >= cells - border;
+            if (isBorder)
+                borderErrors += bit;
+            else
+                code = (code << 1) | bit;
+        }
+    }
+
+    return borderErrors <= maxBorderErrors;
+}
+
+/**
+ * @brief detect the markers of every dictionary on the image
+ *
+ * @param image grayscale or BGR frame (color masks from processFrame() work as is)
+ * @param params detector parameters (candidate filtering, bit extraction and corner refinement)
+ * @param corners marker corners, same order as cv::aruco::detectMarkers
+ * @param ids marker ids
+ * @param dictSlots index in dictNames of the dictionary each marker belongs to
+ */
+void MultiDictDetector::detect(const cv::Mat &image, const cv::Ptr<cv::aruco::DetectorParameters> &params,
+                               std::vector<std::vector<cv::Point2f> > &corners, std::vector<int> &ids,
+                               std::vector<int> &dictSlots) const {
+    cv::Mat gray = image;
+    if (image.channels() == 3)
+        cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
+
+    corners.clear();
+    ids.clear();
+    dictSlots.clear();
+
+    std::vector<std::vector<cv::Point2f> > candidates;
+    findCandidates(gray, params, candidates);
+
+    // a marker resampled on a smaller or bigger grid can land close to a code of that size: with several grid sizes
+    // the border ring has to be read without a single error, and a candidate that still decodes at more than one
+    // size is dropped rather than guessed
+    bool mixedSizes = this->codeIndex.size() > 1;
+
+    for (auto &candidate : candidates) {
+        CodeEntry best{-1, -1, 0, 0};
+        int matchingSizes = 0;
+
+        // one bit read per grid size, however many dictionaries share it
+        for (auto &pair : this->codeIndex) {
+            uint64_t code;
+            CodeEntry entry;
+            if (extractBits(gray, candidate, pair.first, params, mixedSizes, code) and
+                lookup(pair.first, code, entry)) {
+                best = entry;
+                matchingSizes++;
+            }
+        }
+
+        if (matchingSizes != 1)
+            continue;
+
+        bool seen = false;
+        for (int i = 0; i < ids.size(); i++)
+            if (ids[i] == best.id and dictSlots[i] == best.dictSlot)
+                seen = true;
+        if (seen)
+            continue;
+
+        std::vector<cv::Point2f> markerCorners = candidate;
+        std::rotate(markerCorners.begin(), markerCorners.begin() + 4 - best.rotation, markerCorners.end());
+
+        corners.push_back(markerCorners);
+        ids.push_back(best.id);
+        dictSlots.push_back(best.dictSlot);
+    }
+
+    if (not supportsCornerRefinement(params->cornerRefinementMethod)) {
+        static std::once_flag warned;
+        std::call_once(warned, [&]() {
+            std::cout << "[WARNING] cornerRefinementMethod " << params->cornerRefinementMethod
+                      << " is not supported with several dictionaries, corners are not refined (use none/subpix)\n";
+        });
+    }
+
+    if (params->cornerRefinementMethod == cv::aruco::CORNER_REFINE_SUBPIX)
+        for (auto &markerCorners : corners)
+            cv::cornerSubPix(gray, markerCorners,
+                             cv::Size(params->cornerRefinementWinSize, params->cornerRefinementWinSize),
+                             cv::Size(-1, -1),
+                             cv::TermCriteria(cv::TermCriteria::MAX_ITER | cv::TermCriteria::EPS,
+                                              params->cornerRefinementMaxIterations,
+                                              params->cornerRefinementMinAccuracy));
+}
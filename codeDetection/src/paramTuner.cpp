@@ -0,0 +1,505 @@
+#include "../include/paramTuner.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <random>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../include/cameraSettings.hpp"
+#include "../include/firmwareEmulator.hpp"
+#include "../include/frameRecording.hpp"
+#include "../include/latencyHarness.hpp"
+#include "../include/sceneGenerator.hpp"
+
+/**
+ * @brief A frame and the ids that should be detected on it
+ */
+struct TunerFrame {
+    cv::Mat image;
+    std::set<int> ids;
+};
+
+/**
+ * @brief One point of the search space and how it performed
+ */
+struct TunerCandidate {
+    int winSizeMin;
+    int winSizeMax;
+    int winSizeStep;
+    double polygonalApproxRate;
+    int cornerRefinement;
+    int delta;
+    int kernelSize;
+
+    double msPerFrame = 0;  // median of the timed passes
+    double recall = 0;      // on the tuning frames
+    int falsePositives = 0;
+    double heldOutRecall = -1;  // only measured for the defaults and the chosen profile
+    bool eligible = true;  // no more false positives than the defaults
+    bool pareto = false;
+
+    auto key() const {
+        return std::make_tuple(winSizeMin, winSizeMax, winSizeStep, polygonalApproxRate, cornerRefinement, delta,
+                               kernelSize);
+    }
+
+    ArucoSettings settings() const {
+        ArucoSettings settings;
+        settings.arucoParams->adaptiveThreshWinSizeMin = winSizeMin;
+        settings.arucoParams->adaptiveThreshWinSizeMax = winSizeMax;
+        settings.arucoParams->adaptiveThreshWinSizeStep = winSizeStep;
+        settings.arucoParams->polygonalApproxAccuracyRate = polygonalApproxRate;
+        settings.arucoParams->cornerRefinementMethod = cornerRefinement;
+        settings.delta = delta;
+        settings.kernelSize = cv::Size(kernelSize, kernelSize);
+        return settings;
+    }
+};
+
+static const char *cornerRefinementName(int method) {
+    switch (method) {
+        case cv::aruco::CORNER_REFINE_SUBPIX:
+            return "subpix";
+        case cv::aruco::CORNER_REFINE_CONTOUR:
+            return "contour";
+        default:
+            return "none";
+    }
+}
+
+// ####################################################################################################################
+
+/**
+ * @brief frames of the led matrix emulator showing random ids, rendered from varying distances, angles and
+ *        exposures
+ *
+ */
+static bool syntheticFrames(const TunerSettings &ts, std::vector<TunerFrame> &frames, cv::Mat &cameraMatrix,
+                            cv::Mat &distortionCoeffs, float &mLen) {
+    const std::map<char, uint32_t> ledColors{{'r', 0xFF0000}, {'g', 0x00FF00}, {'b', 0x0000FF}, {'w', 0xFFFFFF}};
+
+    FirmwareEmulator emulator;
+    if (not emulator.OK)
+        return false;
+
+    int port = open(emulator.portName().c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (port < 0) {
+        std::cout << "[FATAL] Unable to open the firmware emulator serial port (" << emulator.portName() << ")\n";
+        return false;
+    }
+
+    // waits until the firmware redrew the strip, the command is dropped if that takes too long
+    auto command = [&](const std::string &text) {
+        uint64_t revision = emulator.snapshot().revision;
+        if (write(port, text.data(), text.size()) < 0)
+            return false;
+
+        auto start = std::chrono::steady_clock::now();
+        while (emulator.snapshot().revision == revision) {
+            if (std::chrono::steady_clock::now() - start > std::chrono::seconds(1))
+                return false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        char discard[512];
+        while (read(port, discard, sizeof(discard)) > 0)
+            continue;
+        return true;
+    };
+
+    // every frame would be rendered in the wrong color without it
+    std::stringstream setup;
+    setup << "br 80 cl " << std::hex << std::setw(6) << std::setfill('0') << ledColors.at(ts.targetClr) << " ";
+    if (not command(setup.str())) {
+        std::cout << "[FATAL] the firmware emulator did not take the brightness/color setup\n";
+        close(port);
+        return false;
+    }
+
+    int dictIndex = supportedArucoTypes.at(ts.dict);
+    auto dict = cv::aruco::getPredefinedDictionary(dictIndex);
+    cv::RNG rng(ts.seed);
+
+    SceneSettings ss;
+    mLen = (dict->markerSize + 2) * ss.ledPitch;
+    cameraMatrix = SceneGenerator(ss).cameraMatrix();
+    distortionCoeffs = SceneGenerator(ss).distortionCoeffs();
+
+    for (int i = 0; i < ts.frames; i++) {
+        int id = rng.uniform(0, dict->bytesList.rows);
+        if (not command(arucoSerialCode(dictIndex, id))) {
+            std::cout << "[WARNING] the firmware emulator did not show id " << id << ", frame skipped\n";
+            continue;
+        }
+
+        // same camera, the matrix moves around
+        SceneSettings frameSettings = ss;
+        frameSettings.distance = rng.uniform(0.4, 1.2);
+        frameSettings.tilt = cv::Vec3d(rng.uniform(-0.5, 0.5), rng.uniform(-0.5, 0.5), rng.uniform(-0.3, 0.3));
+        frameSettings.offset = cv::Vec2d(rng.uniform(-0.1, 0.1), rng.uniform(-0.06, 0.06));
+        frameSettings.exposure = rng.uniform(0.6, 1.3);
+        frameSettings.seed = ts.seed + i;
+
+        TunerFrame frame;
+        SceneGenerator(frameSettings).render(emulator.snapshot(), frame.image);
+        frame.ids.insert(id);
+        frames.push_back(frame);
+    }
+    close(port);
+
+    return not frames.empty();
+}
+
+/**
+ * @brief frames of a recording, labeled with the ids listed for them in a detections csv
+ *
+ */
+static bool recordedFrames(const TunerSettings &ts, std::vector<TunerFrame> &frames, cv::Mat &cameraMatrix,
+                           cv::Mat &distortionCoeffs, float &mLen) {
+    RecordingReader recording(ts.recording);
+    if (not recording.OK)
+        return false;
+
+    std::ifstream labels(ts.labelsPath);
+    if (not labels.is_open()) {
+        std::cout << "[ERROR] could not open the labels file (" << ts.labelsPath << ")\n";
+        return false;
+    }
+
+    // source,frame,timestamp_ns,dict,id,... - the live loop numbers every captured frame while the recorder may
+    // drop some, so rows are matched on the capture timestamp, the frame number only when there is none
+    std::map<int64_t, std::set<int> > byTimestamp;
+    std::map<int64_t, std::set<int> > byFrame;
+    long otherSources = 0;
+    std::string line;
+    std::getline(labels, line);  // header
+    while (std::getline(labels, line)) {
+        std::stringstream ss(line);
+        std::vector<std::string> fields;
+        for (std::string field; fields.size() < 5 and std::getline(ss, field, ',');)
+            fields.push_back(field);
+
+        if (fields.size() < 5)
+            continue;
+
+        // live logs name the capture source (stored in the recording), batch logs the recording file
+        if (fields[0] != recording.metadata.source and fields[0] != ts.recording) {
+            otherSources++;
+            continue;
+        }
+
+        int64_t timestampNs = std::stoll(fields[2]);
+        if (timestampNs >= 0)
+            byTimestamp[timestampNs].insert(std::stoi(fields[4]));
+        else
+            byFrame[std::stoi(fields[1])].insert(std::stoi(fields[4]));
+    }
+
+    if (otherSources > 0)
+        std::cout << "[WARNING] " << otherSources << " label rows are not from " << ts.recording << " ("
+                  << recording.metadata.source << "), ignored\n";
+
+    long matched = 0;
+    for (int i = 0; i < recording.frameCount(); i++) {
+        TunerFrame frame;
+        int64_t timestampNs;
+        cv::Mat mapped;
+        if (not recording.read(i, mapped, timestampNs))
+            continue;
+
+        frame.image = mapped.clone();  // the mapping goes away with the reader
+        auto &labeled = timestampNs >= 0 ? byTimestamp : byFrame;
+        int64_t key = timestampNs >= 0 ? timestampNs : i;
+        if (labeled.contains(key)) {
+            frame.ids = labeled.at(key);
+            matched++;
+        }
+        frames.push_back(frame);
+    }
+
+    if (matched < long(byTimestamp.size() + byFrame.size()))
+        std::cout << "[WARNING] " << byTimestamp.size() + byFrame.size() - matched
+                  << " labeled frames are not in the recording\n";
+
+    cameraMatrix = recording.metadata.cameraMatrix;
+    distortionCoeffs = recording.metadata.distortionCoeffs;
+    mLen = ts.markerLength > 0 ? ts.markerLength : recording.metadata.markerLength;
+
+    if (cameraMatrix.empty() or mLen <= 0) {
+        std::cout << "[ERROR] " << ts.recording << " has no calibration or marker size (--ms=x)\n";
+        return false;
+    }
+    return not frames.empty();
+}
+
+// ####################################################################################################################
+
+/**
+ * @brief random, distinct points of the search space - the first one is the current default profile
+ *
+ */
+static std::vector<TunerCandidate> searchSpace(const TunerSettings &ts) {
+    const std::vector<int> winSizeMins{3, 5, 7, 9};
+    const std::vector<int> winSizeMaxs{13, 17, 23, 31, 41, 53};
+    const std::vector<int> winSizeSteps{2, 4, 6, 10, 16, 24};
+    const std::vector<double> polygonalApproxRates{0.02, 0.03, 0.04, 0.05, 0.07, 0.1};
+    const std::vector<int> cornerRefinements{cv::aruco::CORNER_REFINE_NONE, cv::aruco::CORNER_REFINE_SUBPIX,
+                                             cv::aruco::CORNER_REFINE_CONTOUR};
+    const std::vector<int> deltas{4, 8, 12, 18, 25, 35};
+    const std::vector<int> kernelSizes{1, 3, 5, 7, 10, 13};
+
+    auto defaults = cv::aruco::DetectorParameters::create();
+    std::vector<TunerCandidate> candidates{{defaults->adaptiveThreshWinSizeMin, defaults->adaptiveThreshWinSizeMax,
+                                            defaults->adaptiveThreshWinSizeStep,
+                                            defaults->polygonalApproxAccuracyRate, defaults->cornerRefinementMethod,
+                                            DELTA, 10}};
+    std::set<decltype(candidates[0].key())> seen{candidates[0].key()};
+
+    cv::RNG rng(ts.seed);
+    auto pick = [&rng](const auto &values) { return values[rng.uniform(0, (int)values.size())]; };
+
+    for (int attempt = 0; candidates.size() <= ts.candidates and attempt < 100 * (ts.candidates + 1); attempt++) {
+        TunerCandidate candidate{pick(winSizeMins), pick(winSizeMaxs), pick(winSizeSteps), pick(polygonalApproxRates),
+                                 pick(cornerRefinements), pick(deltas), pick(kernelSizes)};
+        if (candidate.winSizeMax < candidate.winSizeMin or not seen.insert(candidate.key()).second)
+            continue;
+        candidates.push_back(candidate);
+    }
+
+    return candidates;
+}
+
+/**
+ * @brief Outcome of running one parameter set over a set of frames once
+ */
+struct TunerPass {
+    double ms = 0;
+    int expected = 0;
+    int found = 0;
+    int falsePositives = 0;
+
+    double recall() const {
+        return expected ? double(found) / expected : 0;
+    }
+};
+
+static TunerPass runPass(const DetectionConfig &config, CameraSettings &cs, const std::vector<TunerFrame *> &frames,
+                         float mLen) {
+    cv::Mat frame, maskedFrame;
+    std::vector<MarkerDetection> detections;
+    TunerPass pass;
+
+    for (auto *tunerFrame : frames) {
+        tunerFrame->image.copyTo(frame);  // markers are drawn on it
+
+        auto start = std::chrono::steady_clock::now();
+        detectFrame(cs, config, frame, maskedFrame, mLen, detections);
+        pass.ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        std::set<int> detected;
+        for (auto &detection : detections)
+            detected.insert(detection.id);
+
+        pass.expected += tunerFrame->ids.size();
+        for (int id : detected) {
+            if (tunerFrame->ids.contains(id))
+                pass.found++;
+            else
+                pass.falsePositives++;
+        }
+    }
+
+    return pass;
+}
+
+static DetectionConfig candidateConfig(const TunerCandidate &candidate, const TunerSettings &ts) {
+    DetectionConfig config;
+    makeDetectionConfig(ts.dict, "", false, ts.targetClr, config);
+    candidate.settings().apply(config);
+    return config;
+}
+
+/**
+ * @brief score a candidate on the tuning frames: a discarded warm-up pass (caches, lazy allocations) gives the
+ *        detections - they do not change from pass to pass - then ms/frame is the median of ts.timingPasses timed
+ *        passes, so sub-millisecond differences between candidates are not just scheduling noise
+ *
+ */
+static void evaluate(TunerCandidate &candidate, const TunerSettings &ts, const std::vector<TunerFrame *> &frames,
+                     CameraSettings &cs, float mLen) {
+    DetectionConfig config = candidateConfig(candidate, ts);
+
+    TunerPass warmUp = runPass(config, cs, frames, mLen);
+    candidate.recall = warmUp.recall();
+    candidate.falsePositives = warmUp.falsePositives;
+
+    std::vector<double> passMs;
+    for (int i = 0; i < std::max(1, ts.timingPasses); i++)
+        passMs.push_back(runPass(config, cs, frames, mLen).ms);
+
+    std::nth_element(passMs.begin(), passMs.begin() + passMs.size() / 2, passMs.end());
+    candidate.msPerFrame = passMs[passMs.size() / 2] / frames.size();
+}
+
+/**
+ * @brief Search the detector parameters, mask delta and kernel size for the best ms/frame vs recall tradeoffs,
+ *        print the Pareto front and save the chosen profile where ArucoSettings looks for it at startup
+ *
+ * @param ts search settings
+ * @return true if a profile was saved
+ */
+bool runParamTuner(const TunerSettings &ts) {
+    if (not supportedArucoTypes.contains(ts.dict)) {
+        std::cout << "[FATAL] aruco tag of type {dict" << ts.dict << "} is not supported\n";
+        return false;
+    }
+
+    std::vector<TunerFrame> frames;
+    cv::Mat cameraMatrix, distortionCoeffs;
+    float mLen = 0;
+
+    bool loaded = ts.recording.empty() ? syntheticFrames(ts, frames, cameraMatrix, distortionCoeffs, mLen)
+                                       : recordedFrames(ts, frames, cameraMatrix, distortionCoeffs, mLen);
+    if (not loaded) {
+        std::cout << "[FATAL] no frames to tune on\n";
+        return false;
+    }
+
+    // the chosen profile is checked on frames the search never saw, a seeded shuffle keeps runs reproducible
+    std::vector<TunerFrame *> tuning, heldOut;
+    std::vector<int> indices(frames.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    std::shuffle(indices.begin(), indices.end(), std::mt19937_64(ts.seed));
+
+    int heldOutCount = 0;
+    if (frames.size() > 1)
+        heldOutCount = std::clamp<int>(std::lround(ts.heldOutRate * frames.size()), 1, frames.size() - 1);
+    for (int i = 0; i < indices.size(); i++)
+        (i < heldOutCount ? heldOut : tuning).push_back(&frames[indices[i]]);
+
+    if (heldOut.empty())
+        std::cout << "[WARNING] a single frame, the chosen profile cannot be checked on held-out frames\n";
+
+    CameraSettings cs(cameraMatrix, distortionCoeffs);
+    std::vector<TunerCandidate> candidates = searchSpace(ts);
+
+    std::cout << "[INFO] Tuning on " << tuning.size() << " frames (" << heldOut.size() << " held out), "
+              << candidates.size() << " parameter sets, median of " << std::max(1, ts.timingPasses)
+              << " timed passes each\n";
+
+    for (int i = 0; i < candidates.size(); i++) {
+        evaluate(candidates[i], ts, tuning, cs, mLen);
+        std::cout << "\r[INFO] evaluated " << i + 1 << "/" << candidates.size() << std::flush;
+    }
+    std::cout << "\n";
+
+    // recall alone would reward a low delta/small kernel set that reports wrong ids on every frame: candidates with
+    // more false positives than the defaults can be neither on the front nor chosen
+    int excluded = 0;
+    for (auto &candidate : candidates) {
+        candidate.eligible = candidate.falsePositives <= candidates[0].falsePositives;
+        excluded += not candidate.eligible;
+    }
+    if (excluded > 0)
+        std::cout << "[INFO] " << excluded << " parameter sets left out, more false positives than the defaults ("
+                  << candidates[0].falsePositives << ")\n";
+
+    // Pareto front: nothing else is both faster and at least as good
+    std::vector<TunerCandidate *> order;
+    for (auto &candidate : candidates)
+        order.push_back(&candidate);
+    std::sort(order.begin(), order.end(), [](const TunerCandidate *a, const TunerCandidate *b) {
+        return a->msPerFrame != b->msPerFrame ? a->msPerFrame < b->msPerFrame : a->recall > b->recall;
+    });
+
+    std::vector<TunerCandidate *> front;
+    for (auto *candidate : order)
+        if (candidate->eligible and (front.empty() or candidate->recall > front.back()->recall)) {
+            candidate->pareto = true;
+            front.push_back(candidate);
+        }
+
+    TunerCandidate *chosen = front.back();  // best recall
+    if (ts.minRecall > 0)
+        for (auto *candidate : front)
+            if (candidate->recall >= ts.minRecall) {
+                chosen = candidate;
+                break;
+            }
+
+    if (not heldOut.empty())
+        for (auto *candidate : {&candidates[0], chosen})
+            candidate->heldOutRecall = runPass(candidateConfig(*candidate, ts), cs, heldOut, mLen).recall();
+
+    std::cout << "[INFO] Pareto front (defaults: " << std::fixed << std::setprecision(2) << candidates[0].msPerFrame
+              << " ms/frame, recall " << std::setprecision(3) << candidates[0].recall << ")\n"
+              << "[INFO]   ms/frame  recall  false+  winSize min:max:step  polyApprox  corners  delta  kernel\n";
+    for (auto *candidate : front)
+        std::cout << "[INFO] " << (candidate == chosen ? "* " : "  ") << std::setprecision(2) << std::setw(8)
+                  << candidate->msPerFrame << "  " << std::setprecision(3) << std::setw(6) << candidate->recall
+                  << "  " << std::setw(6) << candidate->falsePositives << "  " << std::setw(10)
+                  << candidate->winSizeMin << ":" << candidate->winSizeMax << ":" << candidate->winSizeStep
+                  << std::setprecision(2) << std::setw(12) << candidate->polygonalApproxRate << std::setw(9)
+                  << cornerRefinementName(candidate->cornerRefinement) << std::setw(7) << candidate->delta
+                  << std::setw(8) << candidate->kernelSize << "\n";
+
+    if (not heldOut.empty())
+        std::cout << "[INFO] held-out recall: chosen " << std::setprecision(3) << chosen->heldOutRecall
+                  << ", defaults " << candidates[0].heldOutRecall << " (" << heldOut.size() << " frames)\n";
+
+    if (not chosen->settings().save(ts.profilePath))
+        return false;
+    std::cout << "[INFO] profile saved to " << ts.profilePath << " (loaded at startup, --profile to pick another)\n";
+
+    if (ts.reportPath.empty())
+        return true;
+
+    cv::FileStorage fs(ts.reportPath, cv::FileStorage::WRITE);
+    if (not fs.isOpened()) {
+        std::cout << "[ERROR] could not open specified file (" << ts.reportPath << ") " << std::endl;
+        return true;
+    }
+
+    fs << "Dictionary" << ts.dict
+       << "Color_Channel" << std::string(1, ts.targetClr)
+       << "Frames" << static_cast<int>(tuning.size())
+       << "Held_Out_Frames" << static_cast<int>(heldOut.size())
+       << "Timing_Passes" << std::max(1, ts.timingPasses)
+       << "Seed" << static_cast<int>(ts.seed)
+       << "Candidates"
+       << "[";
+
+    for (auto *candidate : order)
+        fs << "{:"
+           << "ms_per_frame" << candidate->msPerFrame
+           << "Recall" << candidate->recall
+           << "Held_Out_Recall" << candidate->heldOutRecall
+           << "False_Positives" << candidate->falsePositives
+           << "Eligible" << (int)candidate->eligible
+           << "Pareto" << (int)candidate->pareto
+           << "Chosen" << (int)(candidate == chosen)
+           << "adaptiveThreshWinSizeMin" << candidate->winSizeMin
+           << "adaptiveThreshWinSizeMax" << candidate->winSizeMax
+           << "adaptiveThreshWinSizeStep" << candidate->winSizeStep
+           << "polygonalApproxAccuracyRate" << candidate->polygonalApproxRate
+           << "cornerRefinementMethod" << candidate->cornerRefinement
+           << "delta" << candidate->delta
+           << "kernelSize" << candidate->kernelSize
+           << "}";
+    fs << "]";
+
+    std::cout << "[INFO] tuning report saved to " << ts.reportPath << "\n";
+    return true;
+}
@@ -0,0 +1,135 @@
+#include "../include/preprocessBenchmark.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "../include/arucoPipeline.hpp"
+#include "../include/sceneGenerator.hpp"
+#include "../include/stripePool.hpp"
+
+struct ScalingResult {
+    std::string resolution;
+    int threads;
+    double msPerFrame;
+    double speedup;
+    bool exact;
+};
+
+static double timeMs(int repetitions, const std::function<void()> &run) {
+    run();  // warm up (allocations, lookup tables)
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repetitions; i++)
+        run();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / repetitions;
+}
+
+/**
+ * @brief synthetic led matrix frame of the given size (field of view kept, so the marker covers the same area)
+ *
+ */
+static cv::Mat benchmarkFrame(cv::Size size) {
+    SceneSettings ss;
+    ss.focalLength *= double(size.width) / ss.frameSize.width;
+    ss.frameSize = size;
+
+    LedStripState strip;
+    strip.brightness = 80;
+    for (int i = 0; i < LED_COUNT; i++)
+        if ((i * 7) % 3 == 0)
+            strip.pixels[i] = 0xFF0000;
+
+    cv::Mat frame;
+    SceneGenerator(ss).render(strip, frame);
+    return frame;
+}
+
+/**
+ * @brief Time the serial preprocessing against the striped one for every thread count and check they match
+ *
+ * @param bs benchmark settings
+ * @return true if every striped result was identical to the serial one
+ */
+bool runPreprocessBenchmark(const PreprocessBenchSettings &bs) {
+    int maxThreads = bs.maxThreads > 0 ? bs.maxThreads : std::max(1u, std::thread::hardware_concurrency());
+    const std::vector<std::pair<std::string, cv::Size> > resolutions{{"1080p", cv::Size(1920, 1080)},
+                                                                     {"4K", cv::Size(3840, 2160)}};
+
+    // opencv's own threads are off so the numbers only reflect the stripes, the default is reported as reference
+    int cvThreads = cv::getNumThreads();
+    std::vector<ScalingResult> results;
+    std::vector<std::pair<std::string, double> > opencvDefault;
+    bool allExact = true;
+
+    std::cout << "[INFO] Preprocessing benchmark, color channel " << bs.targetClr << ", " << bs.repetitions
+              << " frames per measure\n";
+
+    for (auto &[name, size] : resolutions) {
+        cv::Mat frame = benchmarkFrame(size), reference, striped;
+
+        cv::setNumThreads(cvThreads);
+        double defaultMs = timeMs(bs.repetitions, [&]() { processFrame(frame, reference, bs.targetClr); });
+        opencvDefault.push_back({name, defaultMs});
+
+        cv::setNumThreads(1);
+        double serialMs = timeMs(bs.repetitions, [&]() { processFrame(frame, reference, bs.targetClr); });
+
+        std::cout << std::fixed << std::setprecision(2) << "[INFO] " << name << " serial: " << serialMs
+                  << " ms/frame (" << defaultMs << " ms/frame with opencv's " << cvThreads << " threads)\n";
+
+        for (int threads = 1; threads <= maxThreads; threads++) {
+            StripePool pool(threads);
+            double ms = timeMs(bs.repetitions, [&]() { processFrameStriped(frame, striped, bs.targetClr, pool); });
+            bool exact = striped.size() == reference.size() and cv::norm(striped, reference, cv::NORM_INF) == 0;
+            allExact = allExact and exact;
+
+            results.push_back({name, threads, ms, serialMs / ms, exact});
+            std::cout << "[INFO]   " << std::setw(2) << threads << " threads: " << std::setw(8) << ms
+                      << " ms/frame  x" << serialMs / ms << (exact ? "" : "  MISMATCH") << "\n";
+        }
+    }
+
+    cv::setNumThreads(cvThreads);
+
+    if (not allExact)
+        std::cout << "[ERROR] striped preprocessing differs from the serial path\n";
+
+    if (bs.reportPath.empty())
+        return allExact;
+
+    cv::FileStorage fs(bs.reportPath, cv::FileStorage::WRITE);
+    if (not fs.isOpened()) {
+        std::cout << "[ERROR] could not open specified file (" << bs.reportPath << ") " << std::endl;
+        return allExact;
+    }
+
+    fs << "Color_Channel" << std::string(1, bs.targetClr)
+       << "Repetitions" << bs.repetitions
+       << "Bit_Exact" << (int)allExact
+       << "OpenCV_Default"
+       << "[";
+    for (auto &[name, ms] : opencvDefault)
+        fs << "{:" << "Resolution" << name << "Threads" << cvThreads << "ms_per_frame" << ms << "}";
+    fs << "]"
+       << "Scaling"
+       << "[";
+    for (auto &result : results)
+        fs << "{:"
+           << "Resolution" << result.resolution
+           << "Threads" << result.threads
+           << "ms_per_frame" << result.msPerFrame
+           << "Speedup" << result.speedup
+           << "Exact" << (int)result.exact
+           << "}";
+    fs << "]";
+
+    std::cout << "[INFO] preprocessing report saved to " << bs.reportPath << "\n";
+    return allExact;
+}
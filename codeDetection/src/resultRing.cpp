@@ -0,0 +1,284 @@
+#include "../include/resultRing.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static size_t ringBytes(uint32_t capacity) {
+    return sizeof(RingHeader) + size_t(capacity) * sizeof(RingSlot);
+}
+
+static uint64_t shmInode(const std::string &name) {
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+        return 0;
+
+    struct stat st;
+    uint64_t inode = fstat(fd, &st) == 0 ? st.st_ino : 0;
+    close(fd);
+    return inode;
+}
+
+int64_t monotonicNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// ####################################################################################################################
+
+/**
+ * @brief Create the shared memory ring, replacing any ring left under the same name
+ *
+ * @param name POSIX shared memory name (ex: /colaruco_results)
+ * @param capacity records kept before the oldest ones are overwritten
+ */
+ResultRingWriter::ResultRingWriter(const std::string &name, uint32_t capacity) : name(name) {
+    if (capacity == 0) {
+        std::cout << "[ERROR] result ring capacity must be greater than zero\n";
+        return;
+    }
+
+    // an existing ring is never truncated, readers may still have it mapped: only its name is removed, the object
+    // lives on until they unmap it, and a fresh one is created
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        std::cout << "[ERROR] could not create shared memory " << name << " (" << std::strerror(errno) << ")\n";
+        return;
+    }
+
+    struct stat st;
+    this->inode = fstat(fd, &st) == 0 ? st.st_ino : 0;
+
+    this->mappedBytes = ringBytes(capacity);
+    void *mapping = MAP_FAILED;
+    if (ftruncate(fd, this->mappedBytes) == 0)
+        mapping = mmap(nullptr, this->mappedBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (mapping == MAP_FAILED) {
+        std::cout << "[ERROR] could not map shared memory " << name << " (" << std::strerror(errno) << ")\n";
+        shm_unlink(name.c_str());
+        return;
+    }
+
+    this->header = static_cast<RingHeader *>(mapping);
+    this->slots = reinterpret_cast<RingSlot *>(static_cast<char *>(mapping) + sizeof(RingHeader));
+
+    this->header->version = RESULT_RING_VERSION;
+    this->header->recordSize = sizeof(ResultRecord);
+    this->header->capacity = capacity;
+    this->header->generation = monotonicNs();
+    this->header->closed.store(0, std::memory_order_relaxed);
+    this->header->head.store(0, std::memory_order_relaxed);
+
+    // readers only trust the layout once the magic is there
+    std::atomic_thread_fence(std::memory_order_release);
+    this->header->magic = RESULT_RING_MAGIC;
+
+    this->OK = true;
+}
+
+ResultRingWriter::~ResultRingWriter() {
+    if (not this->header)
+        return;
+
+    this->header->closed.store(1, std::memory_order_release);
+    munmap(this->header, this->mappedBytes);
+
+    // a newer writer may already own the name
+    if (shmInode(this->name) == this->inode)
+        shm_unlink(this->name.c_str());
+}
+
+/**
+ * @brief write a record in the next slot (overwriting the oldest one once the ring is full)
+ *
+ * @param record publishNs is filled in here
+ */
+void ResultRingWriter::publish(ResultRecord record) {
+    if (not this->OK)
+        return;
+
+    uint64_t sequence = this->header->head.load(std::memory_order_relaxed) + 1;
+    RingSlot &slot = this->slots[sequence % this->header->capacity];
+
+    slot.sequence.store(2 * sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    record.publishNs = monotonicNs();
+    std::memcpy(&slot.record, &record, sizeof(record));
+
+    slot.sequence.store(2 * sequence, std::memory_order_release);
+    this->header->head.store(sequence, std::memory_order_release);
+}
+
+uint64_t ResultRingWriter::published() const {
+    return this->OK ? this->header->head.load(std::memory_order_relaxed) : 0;
+}
+
+// ####################################################################################################################
+
+/**
+ * @brief Map an existing ring. Reading starts with the next record published.
+ *
+ * @param name POSIX shared memory name given to the detector
+ */
+ResultRingReader::ResultRingReader(const std::string &name) : name(name) {
+    attach(true);
+}
+
+ResultRingReader::~ResultRingReader() {
+    detach();
+}
+
+bool ResultRingReader::attach(bool verbose) {
+    int fd = shm_open(this->name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        if (verbose)
+            std::cout << "[ERROR] could not open shared memory " << this->name << " (is the detector running?)\n";
+        return false;
+    }
+
+    struct stat st;
+    void *mapping = MAP_FAILED;
+    if (fstat(fd, &st) == 0 and st.st_size >= off_t(sizeof(RingHeader)))
+        mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (mapping == MAP_FAILED) {
+        if (verbose)
+            std::cout << "[ERROR] could not map shared memory " << this->name << std::endl;
+        return false;
+    }
+
+    this->inode = st.st_ino;
+    this->lastCheckNs = monotonicNs();
+    this->mappedBytes = st.st_size;
+    this->header = static_cast<const RingHeader *>(mapping);
+    this->slots = reinterpret_cast<const RingSlot *>(static_cast<const char *>(mapping) + sizeof(RingHeader));
+
+    bool valid = this->header->magic == RESULT_RING_MAGIC;
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    if (not valid or this->header->version != RESULT_RING_VERSION or
+        this->header->recordSize != sizeof(ResultRecord) or this->header->capacity == 0 or
+        ringBytes(this->header->capacity) > this->mappedBytes) {
+        if (verbose)
+            std::cout << "[ERROR] " << this->name << " is not a compatible result ring\n";
+        return false;
+    }
+
+    this->OK = true;
+    seekLatest();
+    return true;
+}
+
+void ResultRingReader::detach() {
+    if (this->header)
+        munmap(const_cast<RingHeader *>(this->header), this->mappedBytes);
+
+    this->header = nullptr;
+    this->slots = nullptr;
+    this->OK = false;
+}
+
+/**
+ * @brief drop the current mapping and map the ring now published under the name. Reading resumes with the next
+ *        record published, lostRecords() keeps counting across rings.
+ *
+ * @return false if there is no (compatible) ring yet, the reader stays detached and may try again later
+ */
+bool ResultRingReader::reattach() {
+    detach();
+    return attach(false);
+}
+
+/**
+ * @brief the writer closed this ring, or another object now has its name (checked at most every
+ *        RESULT_RING_RECHECK_NS, it costs a few system calls)
+ *
+ */
+bool ResultRingReader::replaced() {
+    if (this->header->closed.load(std::memory_order_acquire))
+        return true;
+
+    int64_t now = monotonicNs();
+    if (now - this->lastCheckNs < RESULT_RING_RECHECK_NS)
+        return false;
+    this->lastCheckNs = now;
+
+    uint64_t current = shmInode(this->name);
+    return current != 0 and current != this->inode;
+}
+
+/**
+ * @brief get the next record in publishing order
+ *
+ * @param record only written when RING_RECORD is returned
+ * @return RING_RECORD, RING_EMPTY when nothing new was published yet, RING_OVERRUN when the producer overwrote
+ *         records that were not read - reading then resumes at the oldest record still in the ring (lostRecords()) -
+ *         or RING_STALE once every record was read and the ring was closed or replaced (reattach())
+ */
+RingReadStatus ResultRingReader::next(ResultRecord &record) {
+    if (not this->OK)
+        return RING_EMPTY;
+
+    uint64_t head = this->header->head.load(std::memory_order_acquire);
+    if (this->nextSequence > head)
+        return replaced() ? RING_STALE : RING_EMPTY;
+
+    uint32_t capacity = this->header->capacity;
+    const RingSlot &slot = this->slots[this->nextSequence % capacity];
+
+    uint64_t before = slot.sequence.load(std::memory_order_acquire);
+    if (before == 2 * this->nextSequence) {
+        ResultRecord copy;
+        std::memcpy(&copy, &slot.record, sizeof(copy));
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (slot.sequence.load(std::memory_order_relaxed) == before) {
+            record = copy;
+            this->nextSequence++;
+            return RING_RECORD;
+        }
+    }
+
+    // the slot already holds a newer record: skip to the oldest one that cannot be overwritten right away
+    head = this->header->head.load(std::memory_order_acquire);
+    uint64_t oldest = head >= capacity ? head - capacity + 2 : 1;
+    uint64_t resume = std::max(this->nextSequence + 1, oldest);
+
+    this->lost += resume - this->nextSequence;
+    this->nextSequence = resume;
+    return RING_OVERRUN;
+}
+
+/**
+ * @brief skip everything already published, next() then waits for a new record
+ *
+ */
+void ResultRingReader::seekLatest() {
+    if (this->OK)
+        this->nextSequence = this->header->head.load(std::memory_order_acquire) + 1;
+}
+
+uint64_t ResultRingReader::lostRecords() const {
+    return this->lost;
+}
+
+uint32_t ResultRingReader::capacity() const {
+    return this->OK ? this->header->capacity : 0;
+}
+
+uint64_t ResultRingReader::generation() const {
+    return this->OK ? this->header->generation : 0;
+}
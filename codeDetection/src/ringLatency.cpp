@@ -0,0 +1,183 @@
+#include "../include/ringLatency.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include <opencv2/core.hpp>
+
+struct ConsumerResult {
+    std::vector<double> latenciesUs;
+    long received = 0;
+    long corrupt = 0;  // payload not matching its frame id, or out of order
+    uint64_t lost = 0;
+};
+
+static double percentile(const std::vector<double> &sorted, double p) {
+    if (sorted.empty())
+        return 0;
+    return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))];
+}
+
+static ResultRecord testRecord(uint64_t frameId) {
+    ResultRecord record{};
+    record.frameId = frameId;
+    record.markerId = frameId % 1000;
+    record.markerCount = 1;
+    record.colorChannel = 'r';
+    std::strncpy(record.dictName, "4_50", sizeof(record.dictName) - 1);
+    for (int i = 0; i < 8; i++)
+        record.corners[i] = frameId + i;
+    for (int i = 0; i < 3; i++)
+        record.rvec[i] = record.tvec[i] = frameId * (i + 1);
+    return record;
+}
+
+static bool recordMatches(const ResultRecord &record) {
+    ResultRecord expected = testRecord(record.frameId);
+    expected.publishNs = record.publishNs;
+    return std::memcmp(&expected, &record, sizeof(record)) == 0;
+}
+
+/**
+ * @brief Measure how long published records take to reach consumers in other mappings of the ring and check that
+ *        overruns are detected
+ *
+ * @param rs test settings
+ * @return true if no record was corrupted and every overrun was accounted for
+ */
+bool runRingLatencyTest(const RingLatencySettings &rs) {
+    std::string name = "/colaruco_latency_" + std::to_string(getpid());
+    ResultRingWriter writer(name, rs.capacity);
+    if (not writer.OK)
+        return false;
+
+    std::cout << "[INFO] Ring latency test: " << rs.records << " records at " << rs.rateHz << " Hz, "
+              << rs.consumers << " consumers, capacity " << rs.capacity << "\n";
+
+    // ----------------------- paced phase: latency -----------------------
+    std::vector<ConsumerResult> results(rs.consumers);
+    std::atomic<int> ready = 0;
+    std::atomic<bool> producerDone = false;
+    std::vector<std::thread> consumers;
+
+    for (int c = 0; c < rs.consumers; c++)
+        consumers.emplace_back([&, c]() {
+            ResultRingReader reader(name);  // separate mapping, like another process would have
+            ConsumerResult &result = results[c];
+            ResultRecord record;
+            uint64_t lastFrame = 0;
+            ready++;
+
+            while (reader.OK) {
+                bool done = producerDone;  // read before next() so the last records are never skipped
+                RingReadStatus status = reader.next(record);
+                if (status == RING_EMPTY) {
+                    if (done)
+                        break;
+                    std::this_thread::yield();
+                    continue;
+                }
+                if (status == RING_OVERRUN)
+                    continue;
+
+                result.latenciesUs.push_back((monotonicNs() - record.publishNs) / 1000.0);
+                if (not recordMatches(record) or (result.received > 0 and record.frameId <= lastFrame))
+                    result.corrupt++;
+                lastFrame = record.frameId;
+                result.received++;
+            }
+            result.lost = reader.lostRecords();
+        });
+
+    while (ready < rs.consumers)
+        std::this_thread::yield();
+
+    auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / std::max(1.0, rs.rateHz)));
+    auto nextPublish = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < rs.records; i++) {
+        std::this_thread::sleep_until(nextPublish);
+        nextPublish += period;
+        writer.publish(testRecord(i));
+    }
+
+    producerDone = true;
+    for (auto &consumer : consumers)
+        consumer.join();
+
+    // ----------------------- burst phase: overrun detection -----------------------
+    ResultRingReader slowReader(name);
+    long burst = 3L * rs.capacity;
+    for (long i = 0; i < burst; i++)
+        writer.publish(testRecord(rs.records + i));
+
+    long burstReceived = 0, burstCorrupt = 0;
+    ResultRecord record;
+    for (RingReadStatus status; (status = slowReader.next(record)) != RING_EMPTY;)
+        if (status == RING_RECORD) {
+            burstReceived++;
+            burstCorrupt += not recordMatches(record);
+        }
+    bool overrunsCounted = slowReader.OK and burstReceived + long(slowReader.lostRecords()) == burst;
+
+    // ----------------------- report -----------------------
+    bool ok = overrunsCounted and burstCorrupt == 0;
+
+    for (int c = 0; c < rs.consumers; c++) {
+        auto &result = results[c];
+        std::sort(result.latenciesUs.begin(), result.latenciesUs.end());
+        ok = ok and result.corrupt == 0 and result.received + long(result.lost) == rs.records;
+
+        std::cout << std::fixed << std::setprecision(2) << "[INFO] consumer " << c << ": " << result.received
+                  << " received, " << result.lost << " lost, " << result.corrupt << " corrupt | latency p50/p99/max "
+                  << percentile(result.latenciesUs, 0.5) << " / " << percentile(result.latenciesUs, 0.99) << " / "
+                  << (result.latenciesUs.empty() ? 0 : result.latenciesUs.back()) << " us\n";
+    }
+    std::cout << "[INFO] burst of " << burst << " records: " << burstReceived << " read, "
+              << slowReader.lostRecords() << " reported lost" << (overrunsCounted ? "" : " (MISMATCH)") << "\n";
+
+    if (not ok)
+        std::cout << "[ERROR] result ring test failed\n";
+
+    if (rs.reportPath.empty())
+        return ok;
+
+    cv::FileStorage fs(rs.reportPath, cv::FileStorage::WRITE);
+    if (not fs.isOpened()) {
+        std::cout << "[ERROR] could not open specified file (" << rs.reportPath << ") " << std::endl;
+        return ok;
+    }
+
+    fs << "Records" << rs.records
+       << "Rate_Hz" << rs.rateHz
+       << "Capacity" << static_cast<int>(rs.capacity)
+       << "Passed" << (int)ok
+       << "Burst_Records" << static_cast<int>(burst)
+       << "Burst_Read" << static_cast<int>(burstReceived)
+       << "Burst_Lost" << static_cast<int>(slowReader.lostRecords())
+       << "Consumers"
+       << "[";
+
+    for (auto &result : results)
+        fs << "{:"
+           << "Received" << static_cast<int>(result.received)
+           << "Lost" << static_cast<int>(result.lost)
+           << "Corrupt" << static_cast<int>(result.corrupt)
+           << "Latency_P50_us" << percentile(result.latenciesUs, 0.5)
+           << "Latency_P99_us" << percentile(result.latenciesUs, 0.99)
+           << "Latency_Max_us" << (result.latenciesUs.empty() ? 0 : result.latenciesUs.back())
+           << "}";
+    fs << "]";
+
+    std::cout << "[INFO] ring latency report saved to " << rs.reportPath << "\n";
+    return ok;
+}
@@ -0,0 +1,55 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "../include/resultRing.hpp"
+
+// Minimal result ring consumer - prints the poses published by arucoRec --ring, and a template for controllers that
+// only link the arucoRing library.
+//
+// usage: ringReader [shared memory name]
+
+int main(int argc, char **argv) {
+    std::string name = argc > 1 ? argv[1] : RESULT_RING_DEFAULT_NAME;
+
+    ResultRingReader reader(name);
+    if (not reader.OK)
+        return -1;
+
+    std::cout << "[INFO] reading " << name << " (" << reader.capacity() << " records)" << std::endl;
+
+    ResultRecord record;
+    while (true) {
+        switch (reader.next(record)) {
+            case RING_EMPTY:
+                std::this_thread::yield();
+                break;
+
+            case RING_STALE:
+                std::cout << "[INFO] the detector closed or replaced " << name << ", waiting for a new ring\n";
+                while (not reader.reattach())
+                    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+                std::cout << "[INFO] reading " << name << " (" << reader.capacity() << " records)" << std::endl;
+                break;
+
+            case RING_OVERRUN:
+                std::cout << "[WARNING] too slow, " << reader.lostRecords() << " records lost so far\n";
+                break;
+
+            case RING_RECORD:
+                if (record.markerId < 0) {
+                    std::cout << "frame " << record.frameId << ": no markers\n";
+                    break;
+                }
+
+                std::cout << std::fixed << std::setprecision(4) << "frame " << record.frameId << " ["
+                          << record.dictName << " " << record.colorChannel << "] id " << record.markerId
+                          << (record.reused ? " (reused)" : "") << " | t " << record.tvec[0] << " " << record.tvec[1] << " " << record.tvec[2] << " | r "
+                          << record.rvec[0] << " " << record.rvec[1] << " " << record.rvec[2] << " | "
+                          << (monotonicNs() - record.publishNs) / 1000 << " us\n";
+                break;
+        }
+    }
+}
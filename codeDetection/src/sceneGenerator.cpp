@@ -0,0 +1,152 @@
+#include "../include/sceneGenerator.hpp"
+
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#include <opencv2/calib3d.hpp>
+#include <opencv2/imgproc.hpp>
+
+#define DOT_OUTLINE_POINTS 12
+#define SUBPIXEL_SHIFT 4
+
+SceneGenerator::SceneGenerator(SceneSettings settings) : settings(settings), rng(settings.seed) {}
+
+/**
+ * @brief physical (column, row) of a led given its index on the strip - odd rows are wired right to left
+ *
+ * @param stripIndex
+ * @return cv::Point
+ */
+cv::Point SceneGenerator::ledPosition(int stripIndex) {
+    int row = stripIndex / LINE_LED_COUNT;
+    int col = stripIndex % LINE_LED_COUNT;
+
+    if (row % 2)
+        col = LINE_LED_COUNT - 1 - col;
+
+    return cv::Point(col, row);
+}
+
+cv::Mat SceneGenerator::cameraMatrix() const {
+    return (cv::Mat_<double>(3, 3) << settings.focalLength, 0, settings.frameSize.width / 2.0,
+            0, settings.focalLength, settings.frameSize.height / 2.0,
+            0, 0, 1);
+}
+
+cv::Mat SceneGenerator::distortionCoeffs() const {
+    return cv::Mat::zeros(5, 1, CV_64F);
+}
+
+/**
+ * @brief render one frame of the led matrix - every lit led is a small disc projected through the camera, followed
+ *        by glow, blur, exposure and sensor noise
+ *
+ * @param strip led strip state to render
+ * @param frame output BGR frame (CV_8UC3)
+ */
+void SceneGenerator::render(const LedStripState &strip, cv::Mat &frame) {
+    const double half = (LINE_LED_COUNT - 1) / 2.0;
+    const double radius = settings.dotRadius * settings.ledPitch;
+
+    // outline of every led disc on the matrix plane (z = 0), centered on the matrix
+    std::vector<cv::Point3f> objectPoints;
+    for (int i = 0; i < LED_COUNT; i++) {
+        cv::Point pos = ledPosition(i);
+        double x = (pos.x - half) * settings.ledPitch;
+        double y = (pos.y - half) * settings.ledPitch;
+
+        for (int k = 0; k < DOT_OUTLINE_POINTS; k++) {
+            double angle = 2 * CV_PI * k / DOT_OUTLINE_POINTS;
+            objectPoints.push_back(cv::Point3f(x + radius * std::cos(angle), y + radius * std::sin(angle), 0));
+        }
+    }
+
+    std::vector<cv::Point2f> imagePoints;
+    cv::Vec3d tvec(settings.offset[0], settings.offset[1], settings.distance);
+    cv::projectPoints(objectPoints, settings.tilt, tvec, cameraMatrix(), distortionCoeffs(), imagePoints);
+
+    cv::Mat canvas(settings.frameSize, CV_32FC3, settings.ambient);
+    cv::Mat leds = cv::Mat::zeros(settings.frameSize, CV_32FC3);
+
+    // adafruit neopixel setBrightness() scales every channel by brightness / 255
+    double scale = settings.ledGain * strip.brightness / 255.0;
+
+    for (int i = 0; i < LED_COUNT; i++) {
+        uint32_t color = strip.pixels[i];
+        if (color == 0)
+            continue;
+
+        cv::Scalar bgr(scale * (color & 0xff), scale * ((color >> 8) & 0xff), scale * ((color >> 16) & 0xff));
+
+        std::vector<cv::Point> outline;
+        for (int k = 0; k < DOT_OUTLINE_POINTS; k++) {
+            cv::Point2f p = imagePoints[i * DOT_OUTLINE_POINTS + k] * (1 << SUBPIXEL_SHIFT);
+            outline.push_back(cv::Point(cvRound(p.x), cvRound(p.y)));
+        }
+        cv::fillConvexPoly(leds, outline, bgr, cv::LINE_8, SUBPIXEL_SHIFT);
+    }
+
+    // halo around the leds, sized from the projected pitch
+    double pitchPixels = settings.focalLength * settings.ledPitch / settings.distance;
+    cv::Mat halo;
+    cv::GaussianBlur(leds, halo, cv::Size(), std::max(0.5, pitchPixels * 0.2));
+    canvas += leds + settings.glow * halo;
+
+    if (settings.blurSigma > 0)
+        cv::GaussianBlur(canvas, canvas, cv::Size(), settings.blurSigma);
+
+    canvas *= settings.exposure;
+
+    if (settings.noiseSigma > 0) {
+        cv::Mat noise(settings.frameSize, CV_32FC3);
+        rng.fill(noise, cv::RNG::NORMAL, cv::Scalar::all(0), cv::Scalar::all(settings.noiseSigma));
+        canvas += noise;
+    }
+
+    canvas.convertTo(frame, CV_8UC3);
+}
+
+// ####################################################################################################################
+
+SyntheticCapture::SyntheticCapture(FirmwareEmulator &emulator, SceneSettings settings)
+    : generator(settings), emulator(emulator), nextFrame(std::chrono::steady_clock::now()) {}
+
+bool SyntheticCapture::isOpened() const {
+    return emulator.OK;
+}
+
+/**
+ * @brief waits for the next frame slot and latches the led strip state (the exposure instant)
+ *
+ */
+bool SyntheticCapture::grab() {
+    if (not isOpened())
+        return false;
+
+    std::this_thread::sleep_until(nextFrame);
+    nextFrame += std::chrono::microseconds(static_cast<int64_t>(1e6 / generator.settings.fps));
+
+    // don't try to catch up after a slow consumer, a camera would have dropped those frames
+    auto now = std::chrono::steady_clock::now();
+    if (nextFrame < now)
+        nextFrame = now;
+
+    grabbedStrip = emulator.snapshot();
+    return true;
+}
+
+bool SyntheticCapture::retrieve(cv::OutputArray image, int flag) {
+    cv::Mat frame;
+    generator.render(grabbedStrip, frame);
+    frame.copyTo(image);
+    return true;
+}
+
+bool SyntheticCapture::read(cv::OutputArray image) {
+    if (grab())
+        return retrieve(image);
+
+    image.release();
+    return false;
+}
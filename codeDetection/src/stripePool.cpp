@@ -0,0 +1,81 @@
+#include "../include/stripePool.hpp"
+
+#include <algorithm>
+
+StripePool::StripePool(int threads) {
+    if (threads <= 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (int i = 1; i < threads; i++)
+        this->workers.emplace_back(&StripePool::workerLoop, this);
+}
+
+StripePool::~StripePool() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+    }
+    this->wake.notify_all();
+
+    for (auto &worker : this->workers)
+        worker.join();
+}
+
+int StripePool::threadCount() const {
+    return this->workers.size() + 1;
+}
+
+/**
+ * @brief run task(0) .. task(taskCount - 1) spread over the pool, returns once all of them are done
+ *
+ * @param taskCount number of tasks
+ * @param task must be safe to call concurrently with different indexes
+ */
+void StripePool::run(int taskCount, const std::function<void(int)> &task) {
+    if (this->workers.empty() or taskCount <= 1) {
+        for (int i = 0; i < taskCount; i++)
+            task(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->job = &task;
+        this->jobTasks = taskCount;
+        this->nextTask = 0;
+        this->busyWorkers = this->workers.size();
+        this->generation++;
+    }
+    this->wake.notify_all();
+
+    drain();
+
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->done.wait(lock, [this]() { return this->busyWorkers == 0; });
+    this->job = nullptr;
+}
+
+void StripePool::drain() {
+    for (int i = this->nextTask++; i < this->jobTasks; i = this->nextTask++)
+        (*this->job)(i);
+}
+
+void StripePool::workerLoop() {
+    unsigned long seen = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->wake.wait(lock, [&]() { return this->stopping or this->generation != seen; });
+            if (this->stopping)
+                return;
+            seen = this->generation;
+        }
+
+        drain();
+
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (--this->busyWorkers == 0)
+            this->done.notify_one();
+    }
+}